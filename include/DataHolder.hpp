@@ -1,6 +1,11 @@
 #pragma once
 
+#include <array>
+#include <atomic>
 #include <cstddef>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <shared_mutex>
 #include <unordered_map>
 #include <vector>
@@ -8,10 +13,19 @@
 #include "FilterOptions.hpp"
 #include "GlobalNamespace/PlayerData.hpp"
 #include "GlobalNamespace/PlayerDataModel.hpp"
+#include "GlobalNamespace/PlayerLevelStatsData.hpp"
 #include "song-details/shared/Data/MapCharacteristic.hpp"
 #include "song-details/shared/Data/Song.hpp"
 #include "song-details/shared/Data/SongDifficulty.hpp"
 #include "song-details/shared/SongDetails.hpp"
+#include "Util/ArtistTable.hpp"
+#include "Util/LRUCache.hpp"
+#include "Util/QuantizedColumns.hpp"
+#include "Util/RangeIndex.hpp"
+#include "Util/RoaringBitmap.hpp"
+#include "Util/SongIndex.hpp"
+#include "Util/TextColumn.hpp"
+#include "Util/TokenIndex.hpp"
 
 /*
     Global data holder for the mod to simplify access to global data
@@ -25,6 +39,69 @@ namespace BetterSongSearch {
         bool isStyle;
     };
 
+    // Songs by value of the categorical filters, built with the dataset
+    // Per difficulty categories contain the songs with at least one matching difficulty
+    struct CategoryBitmaps {
+        std::array<Util::RoaringBitmap, 64> tags;  // By tag bit
+        Util::RoaringBitmap curated;
+        Util::RoaringBitmap verifiedMappers;
+        Util::RoaringBitmap v3Environment;
+        std::unordered_map<FilterTypes::RankedFilter, Util::RoaringBitmap> rankedStates;
+        std::unordered_map<FilterTypes::CharFilter, Util::RoaringBitmap> characteristics;
+        std::unordered_map<FilterTypes::DifficultyFilter, Util::RoaringBitmap> difficulties;
+        std::unordered_map<FilterTypes::Requirement, Util::RoaringBitmap> modRequirements;
+        std::unordered_map<std::string, Util::RoaringBitmap> uploaders;  // By lowercase uploader name without special characters
+
+        std::size_t bytes() const;
+    };
+
+    // Order of the difficulty labels of a song list cell, as difficulty indexes in the song
+    struct DiffLabelOrder {
+        static constexpr std::size_t MAX_LABELS = 8;  // More than the cell shows
+        std::array<uint8_t, MAX_LABELS> diffs = {};
+        uint8_t count = 0;
+    };
+
+    // Difficulties of a song that passed the last filter pass and their stars (preferred leaderboard)
+    struct DiffFilterResult {
+        uint64_t passingDiffs = 0;  // Bit i is set if the i-th difficulty passes, difficulties past 64 are not in the mask
+        float minStars = 0;  // Lowest stars of the passing difficulties, 0 if none is ranked
+        float maxStars = 0;  // Highest stars of the passing difficulties, 0 if none is ranked
+        bool anyPasses = false;
+    };
+
+    // Stars of every difficulty for one (preferred leaderboard, ranked filter) combination, never changed once published
+    struct StarColumn {
+        std::shared_ptr<std::vector<uint32_t> const> diffBase;  // Global difficulty indexes of the dataset it was built for
+        std::vector<float> stars;  // By global difficulty index
+
+        // @return nullopt if the song is not in the dataset the column was built for
+        std::optional<float> Get(SongDetailsCache::SongDifficulty const* diff, SongDetailsCache::Song const* song) const {
+            if (song->index + 1 >= diffBase->size()) {
+                return std::nullopt;
+            }
+            uint32_t diffIndex = (*diffBase)[song->index] + static_cast<uint32_t>(diff - &*song->begin());
+            if (diffIndex >= stars.size()) {
+                return std::nullopt;
+            }
+            return stars[diffIndex];
+        }
+    };
+
+    // DiffFilterResult of a song as the filter workers store it, read without locking.
+    // One worker writes a slot per pass, the stamp is odd while it writes so readers can drop a torn copy (seqlock).
+    struct DiffFilterSlot {
+        std::atomic<uint32_t> stamp = 0;  // Twice the filter generation that wrote it, plus one while writing
+        std::atomic<uint64_t> passingDiffs = 0;
+        std::atomic<uint64_t> stars = 0;  // Bits of minStars (low) and maxStars (high)
+        std::atomic_bool anyPasses = false;
+        // DiffLabelOrder for the sort of the last label pass, with its own stamp since a sort change orders the labels again
+        std::atomic<uint32_t> labelStamp = 0;  // Twice the label generation that wrote it, plus one while writing
+        std::atomic<uint64_t> labelDiffs = 0;  // DiffLabelOrder::diffs, one byte each
+        std::atomic<uint8_t> labelCount = 0;
+    };
+    static_assert(DiffLabelOrder::MAX_LABELS <= sizeof(uint64_t), "Label order has to fit into DiffFilterSlot::labelDiffs");
+
     // Global variables
     class DataHolder {
        public:
@@ -36,11 +113,29 @@ namespace BetterSongSearch {
         UnorderedEventCallback<> loadingFinished;  // Gets called when the loading is done
         UnorderedEventCallback<std::string> loadingFailed;  // Gets called when the loading failed with the error message
         UnorderedEventCallback<> playerDataLoaded;  // Callback when we process more player data
-        UnorderedEventCallback<> searchEnded;  // Callback when the search is done and we have the results
+        UnorderedEventCallback<> searchEnded;  // Callback when the search is done or published partial results (see IsDisplayedSongListPartial)
 
         std::vector<PreprocessedTag> tags = {};  // Preprocessed tags for filter UI
         std::unordered_map<std::string, uint64_t> tagMap = {};
 
+        Util::SongHashIndex hashIndex;  // Binary song hash -> song index
+        Util::MapIdIndex mapIdIndex;  // Sorted map ids for key lookups
+
+        // Sorted song indexes for the range filters, see RangeCandidates
+        Util::RangeIndex<uint32_t> uploadTimeIndex;
+        Util::RangeIndex<float> ratingIndex;
+        Util::RangeIndex<int> votesIndex;
+        Util::RangeIndex<float> durationIndex;
+        CategoryBitmaps categories;  // See CategoryCandidates
+        Util::QuantizedColumns quantizedColumns;  // NJS, NPS and stars by global difficulty index for the filter pass
+
+        // Normalized (see Util::NormalizeSearchText) search text by song index
+        Util::TextColumn songNames;
+        Util::TextColumn songNamesRomaji;  // Romaji of song names with kana, empty for others
+        Util::TextColumn levelAuthorNames;
+        Util::ArtistTable artists;  // Distinct normalized song authors
+        Util::TokenIndex tokenIndex;  // Inverted index over the normalized text for the relevance ranking
+
         // Allow to force reload the song list
         bool forceReload = false;
 
@@ -48,6 +143,8 @@ namespace BetterSongSearch {
         FilterTypes::SortMode currentSort = FilterTypes::SortMode::Newest;  // Current search sort state
         std::string search;  // UI search string
         std::string currentSearch;  // Current search string
+        FilterTypes::RankingMode rankingMode = FilterTypes::RankingMode::Classic;  // UI ranking state
+        FilterTypes::RankingMode currentRankingMode = FilterTypes::RankingMode::Classic;  // Current search ranking state
 
         FilterProfile filterOptions;  // Filter options tied to ui
         FilterProfile filterOptionsCache;  // Filter options for the current search
@@ -62,14 +159,79 @@ namespace BetterSongSearch {
         bool loading = false;
         bool needsRefresh = false;  // Song list needs to be refreshed when shown
         bool searchInProgress = false;
+        std::atomic<long long> lastSearchDurationMs = 0;  // Time from starting the last search to publishing its final results
 
         /// @brief Initializes the data holder and starts loading the song data and subscribing to the events
         void Init();
         void DownloadSongList();
         void PreprocessTags();
-        void UpdatePlayerScores();
+        /// @brief Builds the hash and key indexes for the current song details
+        void PreprocessIndexes();
+        /// @brief Builds the category bitmaps used by CategoryCandidates
+        void PreprocessCategories();
+        /// @brief Normalizes the searchable text of all songs once so the search does not have to do it per song
+        void PreprocessSearchText();
+        /// @brief Songs that pass the upload date, rating, votes and length filters, found with the range indexes
+        /// Only the narrowest ranges are intersected, the other checks are still done by MeetsFilter
+        /// @param candidates Ascending song indexes
+        /// @return False if the ranges are too wide to be worth it, the songs should then all be checked
+        bool RangeCandidates(FilterProfile const& filter, std::vector<uint32_t>& candidates) const;
+        /// @brief Songs that pass the tag, upload flag, ranked, characteristic, difficulty, mod and uploader filters, combined from the category bitmaps
+        /// For the per difficulty categories it's the songs with a matching difficulty, MeetsFilter still checks them
+        /// @return False if none of these filters is set
+        bool CategoryCandidates(FilterProfile const& filter, Util::RoaringBitmap& songs) const;
+        /// @brief Finds a song by hash (any case) using the hash index, nullptr if not found
+        SongDetailsCache::Song const* FindSongByHash(std::string_view hash);
+        /// @brief Scans all player level stats for scores, only runs once unless forced (scores are then updated by UpdatePlayerScore)
+        void UpdatePlayerScores(bool force = false);
+        /// @brief Updates the scores for a single level after it was completed (main thread)
+        void UpdatePlayerScore(GlobalNamespace::PlayerLevelStatsData* stats);
+#ifdef BSS_SCORE_TIMING
+        /// @brief Runs the full rescan every score change used to cost (regex and string set per level id), only to log its time
+        /// @return Number of songs with scores it found
+        std::size_t LegacyScoreScan();
+#endif
         bool SongHasScore(SongDetailsCache::Song const* song);
         bool SongHasScore(std::string_view songhash);
+        bool SongHasScore(uint32_t songIndex);
+
+        /// @brief Checks if the player has a score on a single difficulty (difficulty + characteristic) of a song
+        /// Called for every difficulty in the filter pass so it only does a table lookup and a bit test
+        bool DiffIsPlayed(SongDetailsCache::SongDifficulty const* diff, SongDetailsCache::Song const* song) const {
+            uint32_t diffIndex = GlobalDiffIndex(diff, song);
+            if (diffIndex / 64 >= playedDiffs.size()) {
+                return false;
+            }
+            return (playedDiffs[diffIndex / 64].load(std::memory_order_relaxed) >> (diffIndex % 64)) & 1;
+        }
+
+        /// @brief Index of a difficulty across all songs, UINT32_MAX if the indexes are not built
+        uint32_t GlobalDiffIndex(SongDetailsCache::SongDifficulty const* diff, SongDetailsCache::Song const* song) const {
+            if (song->index + 1 >= diffBase.size()) {
+                return UINT32_MAX;
+            }
+            return diffBase[song->index] + static_cast<uint32_t>(diff - &*song->begin());
+        }
+
+        /// @brief Stars of every difficulty for the current preferred leaderboard and ranked filter, safe to call from any thread.
+        /// Never builds the column, callers fall back to getStars(diff, leaderboard) until the search thread built it.
+        /// @return nullptr if the column is not built yet
+        std::shared_ptr<StarColumn const> GetStarColumn() const;
+        /// @brief Switches the preferred leaderboard, the next search only filters again if a star filter is set
+        void SetPreferredLeaderboard(FilterTypes::PreferredLeaderBoard leaderboard);
+
+        /// @brief Difficulty results of the song from the last filter pass, copied so a running pass can't change them while they are used
+        /// @return nullopt if the last pass didn't check the song (no filter set, or it didn't get to it yet) or a worker is writing it
+        std::optional<DiffFilterResult> GetDiffFilterResult(SongDetailsCache::Song const* song) const;
+        /// @brief Changes whenever the difficulties that pass or their stars can change (filter pass, leaderboard, dataset)
+        uint32_t GetFilterGeneration() const {
+            return filterGeneration;
+        }
+        /// @brief Stores the difficulty results of a song for the current filter pass (filter workers, one per song)
+        void SetDiffFilterResult(uint32_t songIndex, DiffFilterResult const& result);
+        /// @brief Difficulty label order of the song for the current sort, ordered in the background by the filter or label pass
+        /// @return nullopt if the pass didn't order the song (yet) or a worker is writing it
+        std::optional<DiffLabelOrder> GetDiffLabelOrder(SongDetailsCache::Song const* song) const;
         void Search();
         /// @brief Called when the song list UI is done updating the song list
         void SongListUIDone();
@@ -77,17 +239,127 @@ namespace BetterSongSearch {
         std::vector<SongDetailsCache::Song const*> GetDisplayedSongList();
         std::size_t GetDisplayedSongListLength();
         SongDetailsCache::Song const* GetDisplayedSongByIndex(std::size_t index);
+        /// @brief True while the displayed list is a provisional snapshot of a search that is still running
+        bool IsDisplayedSongListPartial();
+        /// @brief Id of the search the displayed list belongs to, snapshots of the same search share it
+        uint32_t GetDisplayedSearchId();
+        /// @brief True if the displayed list is from a search with the same text, filter and sort as the one before (scores, downloads, leaderboard)
+        bool IsDisplayedSongListRefresh();
+        /// @brief Index of the first song that differs from the list of the previous search, compared up to limit
+        /// @return limit if the first limit songs are the same
+        std::size_t GetFirstChangedDisplayedIndex(std::size_t limit);
+        /// @brief Finds where a song of the previous search's list is in the displayed list, looking at the first limit songs
+        /// @return SIZE_MAX if the song is not there (or was not ordered in the previous list)
+        std::size_t MapPreviousDisplayedIndex(std::size_t previousIndex, std::size_t limit);
+        /// @brief Drops all cached search results, call it when anything the filters or the sort read changes
+        void InvalidateSearchCache();
+        /// @brief Ranks more results of a relevance search that stopped at its top results, call it when the end of the list is shown
+        /// Does nothing if the list already has all results or they are being ranked, the list is published again when done
+        void LoadMoreResults();
+        /// @brief True if the displayed list stopped at the top results and LoadMoreResults can add more
+        bool HasMoreResults() const {
+            return _moreResults;
+        }
 
        private:
+        // Song with the keys it is ranked by, better first, ties are ordered by song index
+        struct RankedSong {
+            SongDetailsCache::Song const* song;
+            float weight;
+            float tieWeight;  // Only compared when the weights are equal
+        };
+
         std::vector<SongDetailsCache::Song const*> _filteredSongList;  // Filtered songs
-        std::vector<SongDetailsCache::Song const*> _searchedSongList;  // Searched songs
-        std::vector<SongDetailsCache::Song const*> _displayedSongList;  // Sorted songs (actually displayed)
+        std::vector<RankedSong> _searchedSongList;  // Searched songs (only the first page is ordered)
+        std::vector<RankedSong> _displayedSongList;  // Songs actually displayed
+        // Only the first songs of the displayed list are ordered when it is published, the rest is sorted
+        // in the background or when a song past them is requested
+        std::size_t _displayedSortedCount = 0;
+        uint32_t _displayedGeneration = 0;  // Bumped for every published list so a late tail sort is dropped
+        uint32_t _displayedSearchId = 0;
+        bool _displayedPartial = false;
+        std::atomic<uint32_t> _searchId = 0;  // Incremented for every search that runs
+        std::atomic<uint32_t> _queryChangedSearchId = 0;  // Last search that changed the text, filter or sort
+        // Ordered start of the last list of the previous search, to tell the table what changed
+        std::vector<SongDetailsCache::Song const*> _previousDisplayedSongs;
+
+        // Everything a search result list depends on besides the dataset, scores and downloads
+        struct SearchCacheKey {
+            std::string search;
+            uint64_t filterFingerprint;
+            FilterTypes::SortMode sort;
+            FilterTypes::RankingMode rankingMode;
+
+            bool operator==(SearchCacheKey const& other) const = default;
+        };
+        struct SearchCacheKeyHash {
+            std::size_t operator()(SearchCacheKey const& key) const {
+                return std::hash<std::string>{}(key.search) ^ (key.filterFingerprint * 31 + static_cast<uint64_t>(key.sort) * 7 + static_cast<uint64_t>(key.rankingMode));
+            }
+        };
 
+        // Fully sorted results of recent searches so going back to a query (backspace, sort toggle) doesn't search again
+        std::mutex _searchCacheMutex;
+        Util::LRUCache<SearchCacheKey, std::vector<RankedSong>, SearchCacheKeyHash> _searchCache{8 * 1024 * 1024};
+        uint32_t _searchCacheGeneration = 0;  // Bumped on invalidation so searches started before don't store stale results
+
+        // What LoadMoreResults needs to rank more results of the displayed relevance search
+        struct RelevanceQuery {
+            uint32_t searchId = 0;
+            std::vector<std::string> words;
+            std::vector<uint64_t> allowed;  // Songs that pass the filter, empty for all
+            std::vector<RankedSong> keyMatches;  // Ranked above the text matches
+            FilterTypes::SortMode sort = FilterTypes::SortMode::Newest;
+            std::size_t resultCount = 0;  // k of the last TopK, 0 if the list has every result
+            SearchCacheKey cacheKey;
+            uint32_t cacheGeneration = 0;
+        };
+        std::mutex _relevanceQueryMutex;
+        RelevanceQuery _relevanceQuery;
+        std::atomic_bool _moreResults = false;
+        std::atomic_bool _loadingMoreResults = false;
+
+        // Score bitmaps are written under mutex_songsWithScores but read without locking from the filter pass,
+        // so the words are atomic, set with fetch_or and read with relaxed loads.
+        // They are only resized in PreprocessIndexes (new dataset), score updates change them in place.
         std::shared_mutex mutex_songsWithScores;
-        std::unordered_set<std::string> songsWithScores;  // Songs with scores (hashes) for played songs filtering
+        std::vector<std::atomic<uint64_t>> songsWithScores;  // Bitmap of songs with scores (by song index) for played songs filtering
+        std::size_t songsWithScoresCount = 0;
+        std::vector<std::atomic<uint64_t>> playedDiffs;  // Bitmap of difficulties with scores (by global difficulty index, see diffBase)
+        std::size_t playedDiffsCount = 0;
+        std::vector<uint32_t> diffBase;  // Global index of the first difficulty of each song (by song index), last entry is the total
+        // Filled by the filter pass so sorting and the cells don't check every difficulty again, sized with the dataset
+        std::vector<DiffFilterSlot> diffFilterResults;
+        std::atomic<uint32_t> filterGeneration = 1;  // Bumped for every filter pass, older results are ignored
+        std::atomic<uint32_t> labelGeneration = 1;  // Bumped for every label pass and when the stars change, older label orders are ignored
+        std::atomic_int _labelSortClass = -1;  // Sort class (see LabelSortClass) the labels were last ordered for, -1 to order them again
+
+        // Effective stars per (preferred leaderboard, ranked filter) combination, see GetStarColumn.
+        // Only read and written with std::atomic_load and std::atomic_store, a reader keeps its snapshot alive while the dataset changes.
+        static constexpr std::size_t STAR_COLUMN_COUNT = 6;
+        std::array<std::shared_ptr<StarColumn const>, STAR_COLUMN_COUNT> starColumns;
+        std::shared_ptr<std::vector<uint32_t> const> starDiffBase;  // Copy of diffBase the columns share, guarded by starColumnsMutex
+        std::mutex starColumnsMutex;  // Held by the builder so a dataset change waits for it
+        /// @brief Builds the star column of the current combination if it's missing, only called by the search thread
+        void BuildStarColumn();
+        std::size_t StarColumnIndex() const;
+        bool starsChanged = false;  // The preferred leaderboard changed, star sorts have to sort again
+        bool scoresLoaded = false;  // Initial full scan of the player stats is done
         std::shared_mutex _displayedSongListMutex;
         void SongDataDone();
         void SongDataError(std::string message);
+        /// @brief Orders the displayed list at least up to count, needs the unique lock of _displayedSongListMutex
+        void SortDisplayedSongs(std::size_t count);
+        /// @brief Replaces the displayed list and notifies the UI, a partial list is followed by more for the same search
+        /// @param sorted the list is already fully ordered (from the cache)
+        /// @return Generation of the published list
+        uint32_t PublishDisplayedSongs(std::vector<RankedSong> songs, uint32_t searchId, bool partial, bool sorted = false);
+        /// @brief Stores the displayed list in the search cache once it's fully sorted
+        void CacheDisplayedSongs(SearchCacheKey key, uint32_t generation, uint32_t cacheGeneration);
+        /// @brief Stores the label order of a song for the current label pass (one worker per song)
+        void SetDiffLabelOrder(uint32_t songIndex, DiffLabelOrder const& order);
+        /// @brief Orders the difficulty labels of the songs for a sort on the filter threads, starts a new label pass
+        void OrderDiffLabels(std::vector<SongDetailsCache::Song const*> const& songs, FilterTypes::SortMode sort);
     };
 
     // Instance of the data holder
@@ -4,6 +4,7 @@
 #include <vector>
 
 #include "PluginConfig.hpp"
+#include "Util/QuantizedColumns.hpp"
 #include "rapidjson-macros/shared/macros.hpp"
 
 namespace BetterSongSearch {
@@ -42,6 +43,8 @@ namespace BetterSongSearch {
 
        public:
         bool IsEqual(FilterProfile const& other) const;
+        // @brief Hash of all the values compared by IsEqual, equal profiles have the same fingerprint
+        uint64_t Fingerprint() const;
 
         // Because RapidJSON does not support enums... we have to make methods to convert them to/from int
         FilterTypes::DownloadFilter getDownloadType() {
@@ -86,6 +89,11 @@ namespace BetterSongSearch {
         // This value is valid only if the related filter is not set to "All" and recalculated
         SongDetailsCache::MapDifficulty difficultyFilterPreprocessed = SongDetailsCache::MapDifficulty::Easy;
 
+        // Star, NJS and NPS bounds for the quantized columns, unset star bounds are open
+        Util::QuantizedColumns::Bounds starsBoundsPreprocessed;
+        Util::QuantizedColumns::Bounds njsBoundsPreprocessed;
+        Util::QuantizedColumns::Bounds npsBoundsPreprocessed;
+
         uint64_t _mapStyleBitfield = 0;
         uint64_t _mapGenreBitfield = 0;
         uint64_t _mapGenreExcludeBitfield = 0;
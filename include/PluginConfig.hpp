@@ -20,7 +20,7 @@ static inline std::vector<std::string> const MAP_STYLES_OPTIONS = {"Any", "accur
 
 namespace FilterTypes {
     enum class DownloadFilter { All, OnlyDownloaded, HideDownloaded };
-    enum class LocalScoreFilter { All, HidePassed, OnlyPassed };
+    enum class LocalScoreFilter { All, HidePassed, OnlyPassed, HidePlayedDiffs, OnlyPlayedDiffs };
     enum class RankedFilter { ShowAll, ScoreSaberRanked, BeatLeaderRanked, ScoreSaberQualified, BeatLeaderQualified };
     enum class DifficultyFilter { All, Easy, Normal, Hard, Expert, ExpertPlus };
     enum class CharFilter {
@@ -41,6 +41,9 @@ namespace FilterTypes {
 
     enum class PreferredLeaderBoard { ScoreSaber = 0, BeatLeader = 1 };
 
+    // Classic is the PC compatible weighting, Relevance ranks with the token index (BM25F)
+    enum class RankingMode { Classic = 0, Relevance = 1 };
+
 }  // namespace FilterTypes
 
 // Map for characteristics
@@ -77,6 +80,11 @@ static std::unordered_map<std::string, FilterTypes::PreferredLeaderBoard> const
     {"Scoresaber", FilterTypes::PreferredLeaderBoard::ScoreSaber}, {"Beatleader", FilterTypes::PreferredLeaderBoard::BeatLeader}
 };
 
+// Map for search ranking modes
+static std::unordered_map<std::string, FilterTypes::RankingMode> const RANKING_MODE_MAP = {
+    {"Classic", FilterTypes::RankingMode::Classic}, {"Relevance", FilterTypes::RankingMode::Relevance}
+};
+
 DECLARE_CONFIG(PluginConfig) {
     CONFIG_VALUE(ReturnToBSS, bool, "Return to BSS from Solo", true);
     CONFIG_VALUE(LoadSongPreviews, bool, "Load song previews", true);
@@ -102,6 +110,7 @@ DECLARE_CONFIG(PluginConfig) {
     CONFIG_VALUE(Uploaders, std::string, "Uploaders filter", "");
     CONFIG_VALUE(RequirementType, int, "Requirement Type", 0);
     CONFIG_VALUE(PreferredLeaderboard, std::string, "Preferred Leaderboard", "Scoresaber");
+    CONFIG_VALUE(RankingMode, std::string, "Search Ranking Mode", "Classic");
     CONFIG_VALUE(OnlyVerifiedMappers, bool, "Only Verified Mappers", false);
     CONFIG_VALUE(OnlyCuratedMaps, bool, "Only Curated Maps", false);
     CONFIG_VALUE(OnlyV3Maps, bool, "Only V3 Maps", false);
@@ -25,6 +25,8 @@ DECLARE_CLASS_CODEGEN(BetterSongSearch::UI::Modals, Settings, UnityEngine::MonoB
     DECLARE_BSML_PROPERTY(bool, smallerFontSize);
 
     DECLARE_BSML_PROPERTY(StringW, preferredLeaderboard);
+    DECLARE_BSML_PROPERTY(StringW, rankingMode);
     DECLARE_INSTANCE_FIELD(BSML::ModalView*, settingsModal);
     BSML_OPTIONS_LIST_OBJECT(preferredLeaderboardOptions, "Scoresaber", "Beatleader");
+    BSML_OPTIONS_LIST_OBJECT(rankingModeOptions, "Classic", "Relevance");
 };
@@ -20,6 +20,11 @@
 #include "custom-types/shared/coroutine.hpp"
 #include "custom-types/shared/macros.hpp"
 
+#include <array>
+#include <bit>
+#include <string>
+#include <unordered_map>
+
 #include "Util/RatelimitCoroutine.hpp"
 
 #ifndef DECLARE_OVERRIDE_METHOD_MATCH
@@ -29,6 +34,20 @@
 
 inline static const int RETRY_COUNT = 3;
 
+// Number of history entries in each status, kept up to date by DownloadHistoryEntry::SetStatus
+struct DownloadStatusCounters {
+    std::array<int, 8> counts = {};  // By status bit
+
+    void Add(int status, int delta) { counts[std::countr_zero(static_cast<unsigned>(status))] += delta; }
+    // Number of entries in any of the states
+    int Count(int states) const {
+        int total = 0;
+        for (std::size_t i = 0; i < counts.size(); i++) {
+            if ((states >> i) & 1) total += counts[i];
+        }
+        return total;
+    }
+};
 
 // Make sure to access it only from the main thread (not thread safe)
 class DownloadHistoryEntry {
@@ -42,7 +61,16 @@ public:
         Downloaded = 32,
         Loaded = 64
     };
-    DownloadStatus status = DownloadStatus::Queued;
+    DownloadStatus GetStatus() const { return status; }
+    void SetStatus(DownloadStatus newStatus) {
+        if (counters) {
+            counters->Add(status, -1);
+            counters->Add(newStatus, 1);
+        }
+        status = newStatus;
+    }
+    // Counters of the history the entry is in, set when it's added
+    DownloadStatusCounters* counters = nullptr;
     std::string statusDetails = "";
     std::string statusMessage() {return fmt::format("{} {}", StatusToString(status), statusDetails);}
     float downloadProgress = 1.0f;
@@ -93,7 +121,7 @@ public:
         if(status != DownloadStatus::Failed || retries < RETRY_COUNT)
             return;
 
-        status = DownloadStatus::Queued;
+        SetStatus(DownloadStatus::Queued);
         retries = 0;
     }
 
@@ -105,6 +133,9 @@ public:
     }
 
     std::function<void()> UpdateProgressHandler;
+
+private:
+    DownloadStatus status = DownloadStatus::Queued;
 };
 
 #ifdef HotReload
@@ -128,6 +159,11 @@ DECLARE_CLASS_CODEGEN_INTERFACES(BetterSongSearch::UI::ViewControllers, Download
 public:
     UnityW<HMUI::TableView> downloadHistoryTable() {if(downloadList) {return downloadList->tableView;} else return nullptr;}
     std::vector<DownloadHistoryEntry*> downloadEntryList;
+    // Indexes into downloadEntryList, the entries are never freed so the pointers stay valid
+    std::unordered_map<std::string, DownloadHistoryEntry*> entriesByHash;
+    std::unordered_map<std::string, DownloadHistoryEntry*> entriesByKey;
+    DownloadStatusCounters statusCounters;
+    void AddEntry(DownloadHistoryEntry* entry);
     void ProcessDownloads(bool forceTableReload = false);
     void RefreshTable(bool fullReload = true);
     BetterSongSearch::Util::RatelimitCoroutine* limitedFullTableReload = nullptr;
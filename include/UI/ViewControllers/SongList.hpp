@@ -37,6 +37,7 @@
 #include "UnityEngine/MonoBehaviour.hpp"
 #include "UnityEngine/UI/HorizontalOrVerticalLayoutGroup.hpp"
 #include "UnityEngine/UI/VerticalLayoutGroup.hpp"
+#include "Util/AdaptiveDebounce.hpp"
 #include "Util/RatelimitCoroutine.hpp"
 
 #ifndef DECLARE_OVERRIDE_METHOD_MATCH
@@ -153,9 +154,18 @@ DECLARE_CLASS_CODEGEN_INTERFACES(BetterSongSearch::UI::ViewControllers, SongList
     void SetSelectedSong(SongDetailsCache::Song const* song);
 
     BetterSongSearch::Util::RatelimitCoroutine* limitedUpdateSearchedSongsList = nullptr;
+    BetterSongSearch::Util::AdaptiveDebounce searchDebounce;  // Sizes the search rate limit from measured search times
+    uint32_t shownSearchId = 0;  // Search the table currently shows, its later snapshots keep the scroll position
+    int prefetchSelectedIdx = -1;  // Row the user clicked, its neighbors' covers are prefetched
+    BetterSongSearch::Util::RatelimitCoroutine* limitedUpdateCoverPrefetch = nullptr;  // Prefetches covers for the rows scrolled to
 
     void SortAndFilterSongs(FilterTypes::SortMode sort, std::string_view search, bool resetTable);
     void ResetTable();
+    void RefreshTableKeepingPosition();
+    void UpdateCoverPrefetch();
+    // Shows a cover, owned is true for covers the cover cache didn't take, they are destroyed when another one is shown
+    void SetCoverSprite(UnityW<UnityEngine::Sprite> sprite, bool owned = false);
+    UnityW<UnityEngine::Sprite> ownedCover;
 
     void UpdateDetails();
     void SetIsDownloaded(bool isDownloaded, bool downloadable = true);
@@ -174,7 +184,9 @@ DECLARE_CLASS_CODEGEN_INTERFACES(BetterSongSearch::UI::ViewControllers, SongList
     void SongDataDone();
     void SongDataError(std::string message);
     void PlayerDataLoaded();
+    // Only listener of SongsLoaded, updates the selected song and the visible cells
     void OnSongsLoaded(std::span<SongCore::SongLoader::CustomBeatmapLevel* const> songs);
+    void RefreshDownloadStates();
 
     SongDetailsCache::Song const* GetCurrentSong();
     void SetCurrentSong(SongDetailsCache::Song const* song);
@@ -32,14 +32,16 @@ DECLARE_CLASS_CODEGEN(BetterSongSearch::UI::ViewControllers, CustomSongListTable
     DECLARE_INSTANCE_FIELD(HMUI::ImageView *, bgContainer);
 
     DECLARE_CTOR(ctor);
-    DECLARE_INSTANCE_METHOD(void, OnDestroy);
 
 public:
     CustomSongListTableCell* PopulateWithSongData(const SongDetailsCache::Song* entry);
     const SongDetailsCache::Song* entry;
+    bool shownAsDownloaded;  // Song name has the downloaded color
 
 
     void SetFontSizes();
     void RefreshBgState();
-    void OnSongsLoaded(std::span<SongCore::SongLoader::CustomBeatmapLevel* const> songs);
+    // @brief Updates the song name color if the downloaded state changed (songs loaded)
+    void RefreshDownloadState();
+    void SetDownloadedColor(bool isDownloaded);
 };
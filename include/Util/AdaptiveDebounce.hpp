@@ -0,0 +1,51 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <functional>
+
+namespace BetterSongSearch::Util {
+    /**
+     * Sizes an input debounce window from how long recent searches took.
+     * A high percentile of the last durations is used so one slow search doesn't make typing feel laggy
+     * but a device that is slow every time waits long enough to not queue searches behind each other.
+     * The clock can be replaced so the behaviour doesn't depend on real time.
+     */
+    class AdaptiveDebounce {
+       public:
+        static constexpr std::size_t SampleCount = 16;
+
+        // @param clock current time in ms, CurrentTimeMs if empty
+        explicit AdaptiveDebounce(std::function<long long()> clock = {});
+
+        // @brief Adds the duration of a finished search
+        void RecordLatency(long long ms);
+
+        // @brief Duration below which the given fraction (0 to 1) of the recent searches finished, -1 without samples
+        long long Percentile(float fraction) const;
+
+        // @brief Debounce window in ms, defaultWindowMs until there are samples
+        long long WindowMs() const;
+
+        // @brief Searches are cheap (cached or indexed) and the last one was long enough ago to run the next one right away
+        bool CanFireImmediately(bool pipelineIdle) const;
+
+        // @brief Remembers when the debounced action ran
+        void MarkFired();
+
+        long long defaultWindowMs = 100;
+        long long minWindowMs = 16;  // About a frame
+        long long maxWindowMs = 400;
+        float percentile = 0.75f;
+        float latencyFactor = 1.25f;  // Window relative to the percentile
+        long long cheapWindowMs = 33;  // Windows up to this are cheap enough to skip the frame delay
+
+       private:
+        std::function<long long()> clock;
+        std::array<long long, SampleCount> samples = {};
+        std::size_t sampleCount = 0;
+        std::size_t nextSample = 0;
+        long long lastFiredMs = 0;
+        bool fired = false;
+    };
+}  // namespace BetterSongSearch::Util
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "Util/TextColumn.hpp"
+
+namespace BetterSongSearch::Util {
+    /**
+     * Distinct normalized song author names with the artist id of every song.
+     * Lots of songs share an author, so anything that only depends on the author is done once per artist.
+     */
+    class ArtistTable {
+       public:
+        static constexpr uint32_t npos = UINT32_MAX;
+
+        void Clear();
+        // @brief Adds the author of the next song (songs have to be added in song index order)
+        void Add(std::string_view normalizedName);
+        // @brief Finishes building the table, has to be called after the last Add
+        void Finish();
+
+        // @brief Artist id of a song (no bounds check)
+        uint32_t ArtistOf(std::size_t songIndex) const {
+            return songArtists[songIndex];
+        }
+
+        std::string_view Name(uint32_t artistId) const {
+            return names.at(artistId);
+        }
+
+        // @return Artist id of the exact normalized name or npos
+        uint32_t Find(std::string_view normalizedName) const;
+
+        std::size_t size() const {
+            return names.size();
+        }
+
+        std::size_t bytes() const {
+            return names.bytes() + songArtists.size() * sizeof(uint32_t);
+        }
+
+       private:
+        TextColumn names;  // By artist id
+        std::vector<uint32_t> songArtists;  // Artist id by song index
+        std::unordered_map<std::string_view, uint32_t> ids;  // Views into names, only valid after Finish
+        std::unordered_map<std::string, uint32_t> pendingIds;  // Used while building
+    };
+}  // namespace BetterSongSearch::Util
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "UnityEngine/Sprite.hpp"
+#include "Util/LRUCache.hpp"
+#include "Util/PackedStore.hpp"
+
+namespace BetterSongSearch::Util {
+    /**
+     * Two level cache of song covers, keyed by lowercase song hash.
+     * Decoded sprites of recently shown songs stay in memory within a texture budget and are owned by the cache,
+     * downloaded JPEGs are kept in one packed file in the mod data dir so a cover is only downloaded once.
+     */
+    class CoverCache {
+       public:
+        // Decoded RGBA textures, a 256x256 cover takes 256 KB
+        static constexpr std::size_t MEMORY_MAX_BYTES = 24 * 1024 * 1024;
+        static constexpr std::size_t DISK_MAX_BYTES = 64 * 1024 * 1024;
+        // Covers are evicted down to this, so not every write after the budget is reached evicts
+        static constexpr std::size_t DISK_EVICT_TO_BYTES = 48 * 1024 * 1024;
+
+        CoverCache();
+
+        // @brief Cached sprite of a song, marked as most recently used, main thread only
+        UnityW<UnityEngine::Sprite> GetSprite(std::string const& hash);
+        // @brief Decodes a cover and caches the sprite, main thread only
+        // @param cached Set to false if the sprite is too big to cache, the caller owns it then
+        // @return The sprite or nullptr if the bytes are not an image
+        UnityW<UnityEngine::Sprite> AddSprite(std::string const& hash, std::span<uint8_t const> bytes, bool& cached);
+        // @brief Caches a sprite created elsewhere (covers of downloaded songs), the cache destroys it when evicted
+        // @return false if the sprite is bigger than the whole memory budget, it is not cached and the caller keeps owning it
+        bool PutSprite(std::string const& hash, UnityW<UnityEngine::Sprite> sprite);
+        // @brief Destroys a sprite and its texture, for sprites the cache didn't take
+        static void DestroySprite(UnityW<UnityEngine::Sprite> sprite);
+
+        // @brief Compressed cover from the disk cache, any thread
+        std::optional<std::vector<uint8_t>> ReadCompressed(std::string const& hash);
+        // @brief True if the cover is in the disk cache, any thread
+        bool HasCompressed(std::string const& hash);
+        // @brief Stores a compressed cover on disk, any thread
+        void WriteCompressed(std::string const& hash, std::span<uint8_t const> bytes);
+
+       private:
+        static std::size_t SpriteBytes(UnityW<UnityEngine::Sprite> sprite);
+        // Opens the store on first use, diskMutex must be held
+        bool EnsureStoreOpen();
+        // Drops the least recently used covers over the budget and compacts in the background, diskMutex must be held
+        void TrimStore();
+
+        LRUCache<std::string, UnityW<UnityEngine::Sprite>> sprites;
+
+        std::mutex diskMutex;
+        bool storeOpenTried = false;
+        PackedStore store;
+        std::atomic_bool compacting = false;
+    };
+
+    CoverCache& GetCoverCache();
+}  // namespace BetterSongSearch::Util
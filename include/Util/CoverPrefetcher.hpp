@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace BetterSongSearch::Util {
+    /**
+     * Downloads covers of songs the user is likely to select next into the disk tier of the cover cache.
+     * Each call replaces the queue, so covers of rows the user scrolled away from or of an old result set are dropped
+     * before they start. A few workers at most run at once and a token bucket keeps them under a bandwidth cap,
+     * covers downloaded for the selected song are charged to the same bucket so prefetching backs off for them.
+     */
+    class CoverPrefetcher {
+       public:
+        static constexpr std::size_t MAX_CONCURRENT = 2;
+        static constexpr double BYTES_PER_SECOND = 384 * 1024;
+        static constexpr double BURST_BYTES = 256 * 1024;
+
+        // @brief Replaces what is queued with these lowercase song hashes, most wanted first
+        void Prefetch(std::vector<std::string> hashes);
+        // @brief Drops everything that hasn't started
+        void Cancel();
+        // @brief Counts bytes downloaded outside the prefetcher against the bandwidth cap
+        void Charge(std::size_t bytes);
+
+       private:
+        void Worker();
+        // Adds the tokens earned since the last refill, mutex must be held
+        void Refill();
+
+        std::mutex mutex;
+        std::deque<std::string> queue;
+        std::unordered_set<std::string> inFlight;
+        std::size_t workers = 0;
+        double tokens = BURST_BYTES;  // Can go negative, workers wait until it's paid back
+        long long lastRefillMs = 0;
+    };
+
+    CoverPrefetcher& GetCoverPrefetcher();
+}  // namespace BetterSongSearch::Util
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+namespace BetterSongSearch::Util {
+    /**
+     * Bounded approximate substring matcher using Myers' bit-parallel edit distance.
+     * Finds the smallest Levenshtein distance between the pattern and any substring of a text
+     * in a single pass over the text, the pattern is kept as bitmasks in one machine word.
+     */
+    class FuzzyPattern {
+       public:
+        static constexpr std::size_t MaxLength = 64;
+
+        // @brief Sets the pattern
+        // @return False if the pattern is empty or longer than MaxLength
+        bool Set(std::string_view pattern);
+
+        std::size_t length() const {
+            return patternLength;
+        }
+
+        // @brief Smallest edit distance between the pattern and a substring of the text
+        // @return The distance or maxDistance + 1 if it's above maxDistance
+        int Distance(std::string_view text, int maxDistance) const;
+
+       private:
+        std::array<uint64_t, 256> peq = {};  // Bitmask of pattern positions for every byte
+        uint64_t lastBit = 0;
+        std::size_t patternLength = 0;
+    };
+
+    // @brief Max edit distance allowed for a query word of the given length, 0 means it has to match exactly
+    int FuzzyMaxDistance(std::size_t wordLength);
+}  // namespace BetterSongSearch::Util
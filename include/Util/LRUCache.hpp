@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+namespace BetterSongSearch::Util {
+    /**
+     * Least recently used cache with a memory budget.
+     * The caller tells how many bytes a value takes, the oldest entries are dropped until the total fits.
+     * Not thread safe.
+     */
+    template <typename Key, typename Value, typename Hash = std::hash<Key>>
+    class LRUCache {
+       public:
+        // Called with values dropped to stay within the budget, for values that own something outside the cache
+        using EvictCallback = std::function<void(Key const&, Value&)>;
+
+        explicit LRUCache(std::size_t maxBytes, EvictCallback onEvict = nullptr) : maxBytes(maxBytes), onEvict(std::move(onEvict)) {}
+
+        // @brief Finds a value and marks it as most recently used
+        // @return Pointer to the value (valid until the cache is changed) or nullptr if not cached
+        Value const* Get(Key const& key) {
+            auto it = index.find(key);
+            if (it == index.end()) {
+                return nullptr;
+            }
+            entries.splice(entries.begin(), entries, it->second);
+            return &it->second->value;
+        }
+
+        // @brief Adds or replaces a value
+        // @return false if the value is bigger than the whole budget, it is not cached and not passed to onEvict, the caller keeps it
+        bool Put(Key key, Value value, std::size_t bytes) {
+            Erase(key);
+            if (bytes > maxBytes) {
+                return false;
+            }
+            entries.push_front({std::move(key), std::move(value), bytes});
+            index.emplace(entries.front().key, entries.begin());
+            usedBytes += bytes;
+
+            while (usedBytes > maxBytes) {
+                auto& oldest = entries.back();
+                if (onEvict) {
+                    onEvict(oldest.key, oldest.value);
+                }
+                usedBytes -= oldest.bytes;
+                index.erase(oldest.key);
+                entries.pop_back();
+            }
+            return true;
+        }
+
+        void Erase(Key const& key) {
+            auto it = index.find(key);
+            if (it == index.end()) {
+                return;
+            }
+            usedBytes -= it->second->bytes;
+            entries.erase(it->second);
+            index.erase(it);
+        }
+
+        void Clear() {
+            index.clear();
+            entries.clear();
+            usedBytes = 0;
+        }
+
+        std::size_t size() const {
+            return entries.size();
+        }
+
+        std::size_t bytes() const {
+            return usedBytes;
+        }
+
+       private:
+        struct Entry {
+            Key key;
+            Value value;
+            std::size_t bytes;
+        };
+
+        // Most recently used first
+        std::list<Entry> entries;
+        std::unordered_map<Key, typename std::list<Entry>::iterator, Hash> index;
+        std::size_t maxBytes;
+        std::size_t usedBytes = 0;
+        EvictCallback onEvict;
+    };
+}  // namespace BetterSongSearch::Util
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace BetterSongSearch::Util {
+    /**
+     * Single file store for small blobs (song covers) keyed by short strings.
+     * Values are appended to <path>.pack as checksummed records, a memory mapped open addressing table in <path>.idx
+     * maps keys to their record. After a crash the pack is cut at the first record that doesn't check out and the index
+     * is brought up to date from the records it doesn't cover yet, a lost or mismatched index is rebuilt from the pack.
+     * Replaced and erased values stay in the pack as dead bytes until Compact rewrites it.
+     * Not thread safe.
+     */
+    class PackedStore {
+       public:
+        static constexpr std::size_t KEY_SIZE = 40;  // Longer keys are cut, song hashes fit exactly
+
+        struct Entry {
+            std::string key;
+            uint32_t length;
+            uint32_t timestamp;
+        };
+
+        PackedStore() = default;
+        ~PackedStore();
+        PackedStore(PackedStore const&) = delete;
+        PackedStore& operator=(PackedStore const&) = delete;
+
+        // @brief Opens or creates the store, recovering from an interrupted write
+        bool Open(std::string path);
+        void Close();
+        bool IsOpen() const {
+            return packFd >= 0;
+        }
+
+        // @return The value or nullopt if it's missing or its record is damaged (it's erased then)
+        std::optional<std::vector<uint8_t>> Read(std::string_view key);
+        bool Contains(std::string_view key) const;
+        // @brief Appends a value, replacing the previous one of the key
+        bool Write(std::string_view key, std::span<uint8_t const> value, uint32_t timestamp);
+        void Erase(std::string_view key);
+        // @brief Changes the timestamp in the index only, a rebuilt index has the timestamp of the write again
+        void Touch(std::string_view key, uint32_t timestamp);
+
+        std::vector<Entry> Entries() const;
+        std::size_t size() const {
+            return liveCount;
+        }
+        // @brief Bytes of the values that can be read
+        std::size_t LiveBytes() const {
+            return liveBytes;
+        }
+        std::size_t FileBytes() const {
+            return packEnd;
+        }
+        // @brief Bytes cut from the end of the pack when it was opened, from a write that didn't finish
+        std::size_t RecoveredBytes() const {
+            return recoveredBytes;
+        }
+
+        // @brief True when more than half of a pack that is worth rewriting is dead
+        bool NeedsCompaction() const;
+        // @brief Rewrites the pack with only the live values
+        bool Compact();
+
+       private:
+        struct IndexHeader;
+        struct Slot;
+
+        Slot* FindSlot(char const* key, bool forInsert) const;
+        // Updates the index for a record appended at offset
+        void Apply(uint32_t magic, char const* key, uint64_t offset, uint32_t length, uint32_t timestamp);
+        // Replaces the index with a new one holding the given slots
+        bool CreateIndex(uint32_t capacity, uint64_t packId, uint64_t packSize, std::vector<Slot> const& live);
+        bool MapIndex();
+        void UnmapIndex();
+        bool Grow();
+        void CountSlots();
+        // Applies the records after the part of the pack the index covers, cutting the pack at the first damaged one
+        void Replay();
+        bool AppendRecord(uint32_t magic, char const* key, std::span<uint8_t const> value, uint32_t timestamp, uint64_t& offset);
+
+        std::string path;
+        int packFd = -1;
+        uint64_t packId = 0;
+        uint64_t packEnd = 0;
+
+        int indexFd = -1;
+        void* indexMap = nullptr;
+        std::size_t indexMapSize = 0;
+        IndexHeader* header = nullptr;
+        Slot* slots = nullptr;
+
+        std::size_t liveCount = 0;
+        std::size_t usedSlots = 0;  // Live and erased, erased slots keep probe chains intact
+        std::size_t liveBytes = 0;
+        std::size_t deadBytes = 0;
+        std::size_t recoveredBytes = 0;
+    };
+}  // namespace BetterSongSearch::Util
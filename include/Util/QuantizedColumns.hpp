@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace BetterSongSearch::Util {
+    // Result of comparing a quantized value with filter bounds
+    enum class BoundCheck : uint8_t {
+        Fails,  // The exact value is outside the bounds
+        Passes,  // The exact value is inside the bounds
+        Edge,  // Too close to a bound, the exact value has to be checked
+    };
+
+    /**
+     * Fixed point copies of the per difficulty filter values, 8 bytes per difficulty by global difficulty index.
+     * The filter pass checks these first so most difficulties are decided without reading the SongDifficulty struct.
+     */
+    class QuantizedColumns {
+       public:
+        static constexpr float NJS_SCALE = 10.0f;
+        static constexpr float NPS_SCALE = 100.0f;
+        static constexpr float STARS_SCALE = 100.0f;
+        // Marks a difficulty without NPS (song duration unknown), the NPS filter doesn't apply to it
+        static constexpr uint16_t NO_VALUE = UINT16_MAX;
+
+        struct Entry {
+            uint16_t njs;
+            uint16_t nps;
+            uint16_t starsSS;
+            uint16_t starsBL;
+        };
+
+        // Filter bounds in steps of a column, made once per filter pass so checking a value only compares integers
+        struct Bounds {
+            int32_t min = 0;
+            int32_t max = 0;
+        };
+
+        void Clear() {
+            entries.clear();
+        }
+
+        void Reserve(std::size_t count) {
+            entries.reserve(count);
+        }
+
+        // @param nps Negative if the difficulty has no NPS
+        void Push(float njs, float nps, float starsSS, float starsBL);
+
+        // @brief Values of a difficulty (no bounds check)
+        Entry const& at(std::size_t diffIndex) const {
+            return entries[diffIndex];
+        }
+
+        std::size_t size() const {
+            return entries.size();
+        }
+
+        std::size_t bytes() const {
+            return entries.size() * sizeof(Entry);
+        }
+
+        // @brief Quantizes a value by rounding down, saturating at NO_VALUE - 1
+        static uint16_t Quantize(float value, float scale);
+
+        // @brief Quantizes the filter bounds [min, max] of a column with the given scale
+        static Bounds MakeBounds(float scale, float min, float max);
+
+        // @brief Conservatively compares a quantized value with bounds made by MakeBounds
+        // Only values a full step away from both bounds are decided, so rounding can't change the result
+        static BoundCheck Check(uint16_t quantized, Bounds const& bounds) {
+            // The exact value is in [q, q + 1) / scale, one more step of margin covers the float rounding
+            int32_t q = quantized;
+            // 0 holds everything below one step (unranked stars are 0), that is still enough to fail a min bound
+            if (q == 0) {
+                return q + 2 <= bounds.min ? BoundCheck::Fails : BoundCheck::Edge;
+            }
+            // Saturated values don't say where the exact value is
+            if (q >= NO_VALUE - 1) {
+                return BoundCheck::Edge;
+            }
+            if (q + 2 <= bounds.min || q >= bounds.max + 2) {
+                return BoundCheck::Fails;
+            }
+            if (q >= bounds.min + 2 && q + 2 <= bounds.max) {
+                return BoundCheck::Passes;
+            }
+            return BoundCheck::Edge;
+        }
+
+       private:
+        std::vector<Entry> entries;
+    };
+}  // namespace BetterSongSearch::Util
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <span>
+#include <vector>
+
+namespace BetterSongSearch::Util {
+    /**
+     * Song indexes sorted by one numeric column, so a value range is found with a binary search.
+     * The bounds are compared with the same operators as the per song filter checks, so a range gives exactly the songs that pass that check.
+     */
+    template <typename T>
+    class RangeIndex {
+       public:
+        // @brief Rebuilds the index, values[i] is the value of the song with index i
+        void Build(std::vector<T> const& values) {
+            songs.resize(values.size());
+            std::iota(songs.begin(), songs.end(), 0);
+            std::stable_sort(songs.begin(), songs.end(), [&values](uint32_t a, uint32_t b) {
+                return values[a] < values[b];
+            });
+            sortedValues.resize(values.size());
+            for (std::size_t i = 0; i < songs.size(); i++) {
+                sortedValues[i] = values[songs[i]];
+            }
+        }
+
+        void Clear() {
+            songs.clear();
+            sortedValues.clear();
+        }
+
+        // @brief Songs where !(value < min)
+        template <typename Bound>
+        std::span<uint32_t const> AtLeast(Bound min) const {
+            return Slice(LowerBound(min), songs.size());
+        }
+
+        // @brief Songs where !(value > max)
+        template <typename Bound>
+        std::span<uint32_t const> AtMost(Bound max) const {
+            return Slice(0, UpperBound(max));
+        }
+
+        // @brief Songs where !(value < min) && !(value > max)
+        template <typename Bound>
+        std::span<uint32_t const> Between(Bound min, Bound max) const {
+            return Slice(LowerBound(min), UpperBound(max));
+        }
+
+        std::size_t size() const {
+            return songs.size();
+        }
+
+       private:
+        template <typename Bound>
+        std::size_t LowerBound(Bound min) const {
+            auto it = std::partition_point(sortedValues.begin(), sortedValues.end(), [&min](T const& value) {
+                return value < min;
+            });
+            return it - sortedValues.begin();
+        }
+
+        template <typename Bound>
+        std::size_t UpperBound(Bound max) const {
+            auto it = std::partition_point(sortedValues.begin(), sortedValues.end(), [&max](T const& value) {
+                return !(value > max);
+            });
+            return it - sortedValues.begin();
+        }
+
+        std::span<uint32_t const> Slice(std::size_t from, std::size_t to) const {
+            if (from >= to) {
+                return {};
+            }
+            return std::span<uint32_t const>(songs).subspan(from, to - from);
+        }
+
+        std::vector<uint32_t> songs;  // Song indexes by ascending value
+        std::vector<T> sortedValues;  // sortedValues[i] is the value of songs[i]
+    };
+}  // namespace BetterSongSearch::Util
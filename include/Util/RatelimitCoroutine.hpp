@@ -8,6 +8,7 @@ namespace BetterSongSearch::Util {
 	class RatelimitCoroutine {
 		std::function<void()> exitfn;
 		float limit;
+		std::function<float()> limitProvider;
         public:
         
 		RatelimitCoroutine(std::function<void()> exitfn, float limit = 0.5f) {
@@ -15,6 +16,13 @@ namespace BetterSongSearch::Util {
 			this->limit = limit;
 		}
 
+		// The limit is asked for every time the function runs, so it can follow how long the function takes
+		RatelimitCoroutine(std::function<void()> exitfn, std::function<float()> limitProvider) {
+			this->exitfn = exitfn;
+			this->limit = 0.5f;
+			this->limitProvider = limitProvider;
+		}
+
 		bool wasRecentlyExecuted = false;
 		bool queuedFallingEdge = false;
 
@@ -37,7 +45,8 @@ namespace BetterSongSearch::Util {
 		custom_types::Helpers::Coroutine CallNow() {
 			exitfn();
 
-			co_yield reinterpret_cast<System::Collections::IEnumerator*>(UnityEngine::WaitForSeconds::New_ctor(limit));
+			float currentLimit = limitProvider ? limitProvider() : limit;
+			co_yield reinterpret_cast<System::Collections::IEnumerator*>(UnityEngine::WaitForSeconds::New_ctor(currentLimit));
 
 			if(queuedFallingEdge) {
 				queuedFallingEdge = false;
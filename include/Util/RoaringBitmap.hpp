@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace BetterSongSearch::Util {
+    /**
+     * Compressed set of song indexes (Roaring style).
+     * Values are split into chunks of 65536 by their high 16 bits, a chunk keeps a sorted array of the low bits
+     * while it has at most 4096 values and a plain 8 KB bitmap above that, so sparse and dense sets both stay small.
+     */
+    class RoaringBitmap {
+       public:
+        static constexpr std::size_t ARRAY_MAX_SIZE = 4096;
+
+        // @brief Adds a value, appending in ascending order is the fast path
+        void Add(uint32_t value);
+        bool Contains(uint32_t value) const;
+        void Clear();
+
+        // @brief Builds a bitmap from ascending values
+        static RoaringBitmap FromSorted(std::span<uint32_t const> values);
+
+        RoaringBitmap& operator&=(RoaringBitmap const& other);
+        RoaringBitmap& operator|=(RoaringBitmap const& other);
+        // @brief Removes the values of other (and not)
+        RoaringBitmap& operator-=(RoaringBitmap const& other);
+
+        // @brief Appends all values in ascending order
+        void ToVector(std::vector<uint32_t>& out) const;
+
+        std::size_t Cardinality() const;
+        bool empty() const {
+            return chunks.empty();
+        }
+        // @brief Approximate heap memory used
+        std::size_t bytes() const;
+
+       private:
+        struct Chunk {
+            uint16_t key;  // High 16 bits of the values
+            uint32_t cardinality = 0;
+            std::vector<uint16_t> array;  // Sorted low bits while the chunk is sparse
+            std::vector<uint64_t> bits;  // 1024 words once the chunk is dense, empty otherwise
+
+            bool IsBitmap() const {
+                return !bits.empty();
+            }
+        };
+
+        // Sorted by key, no empty chunks
+        std::vector<Chunk> chunks;
+    };
+}  // namespace BetterSongSearch::Util
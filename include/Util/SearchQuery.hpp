@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Util/ArtistTable.hpp"
+
+namespace BetterSongSearch::Util {
+    struct SearchToken {
+        std::string_view text;  // View into the query buffer
+        uint32_t keyValue = 0;  // Parsed key, valid if maybeKey
+        bool maybeKey = false;  // Token is 1 to 8 hex chars so it could be a beatsaver key
+        uint32_t artistId = ArtistTable::npos;  // Artist whose normalized name is exactly this token
+        bool isKnownAuthor = false;  // artistId is valid
+    };
+
+    /**
+     * Normalized search query split into tokens once per search.
+     * Tokens are views into the owned buffer, so the query is neither copyable nor movable
+     * and workers share it by const reference.
+     */
+    class SearchQuery {
+       public:
+        // @param search raw search string from the UI
+        // @param artists used to find tokens that are exactly an author name
+        SearchQuery(std::string_view search, ArtistTable const& artists);
+        SearchQuery(SearchQuery const&) = delete;
+        SearchQuery& operator=(SearchQuery const&) = delete;
+
+        // @brief Whole normalized query
+        std::string_view text() const {
+            return buffer;
+        }
+
+        std::vector<SearchToken> const& tokens() const {
+            return _tokens;
+        }
+
+        bool empty() const {
+            return _tokens.empty();
+        }
+
+       private:
+        std::string buffer;
+        std::vector<SearchToken> _tokens;
+    };
+}  // namespace BetterSongSearch::Util
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace BetterSongSearch::Util {
+    // Binary form of a beatmap hash (SHA1, 40 hex chars -> 20 bytes)
+    using SongHash = std::array<uint8_t, 20>;
+
+    // @brief Decodes a 40 char hex hash (any case) into its binary form without allocating
+    // @return False if the input is not a valid hash
+    bool DecodeHash(std::string_view hex, SongHash& out);
+    bool DecodeHash(std::u16string_view hex, SongHash& out);
+
+    /**
+     * Dense open-addressing index from binary song hash to song index.
+     * Hashes are SHA1 so the first bytes are already uniformly distributed and are used directly as the slot hash.
+     */
+    class SongHashIndex {
+       public:
+        static constexpr uint32_t npos = UINT32_MAX;
+
+        // @brief Rebuilds the index, hashes[i] is the hash of the song with index i
+        void Build(std::vector<SongHash> hashes);
+        void Clear();
+
+        // @return Song index or npos if not found
+        uint32_t Find(SongHash const& hash) const;
+        uint32_t Find(std::string_view hex) const;
+
+        // @brief Binary hash of a song by index (no bounds check)
+        SongHash const& HashAt(uint32_t songIndex) const {
+            return hashes[songIndex];
+        }
+
+        std::size_t size() const {
+            return hashes.size();
+        }
+
+       private:
+        // Song index + 1, 0 means the slot is empty
+        std::vector<uint32_t> slots;
+        std::vector<SongHash> hashes;
+        uint32_t mask = 0;
+    };
+
+    /**
+     * Sorted (mapId, song index) array for exact and prefix beatsaver key lookups
+     */
+    class MapIdIndex {
+       public:
+        static constexpr uint32_t npos = UINT32_MAX;
+
+        // @brief Rebuilds the index, mapIds[i] is the map id of the song with index i
+        void Build(std::vector<uint32_t> const& mapIds);
+        void Clear();
+
+        // @return Song index or npos if not found
+        uint32_t Find(uint32_t mapId) const;
+
+        /**
+         * Finds all songs whose key (lowercase hex without leading zeros) starts with the given hex prefix.
+         * Each possible key length is a contiguous id range so this is a handful of binary searches.
+         * @param prefix hex prefix (any case)
+         * @param out receives song indexes, exact match first
+         * @param limit max number of results
+         */
+        void FindByKeyPrefix(std::string_view prefix, std::vector<uint32_t>& out, std::size_t limit = 100) const;
+
+       private:
+        std::vector<std::pair<uint32_t, uint32_t>> entries;  // (mapId, song index) sorted by mapId
+    };
+
+    // @brief Parses a beatsaver key (1 to 8 hex chars)
+    // @return False if it's not a valid key
+    bool ParseSongKey(std::string_view key, uint32_t& out);
+}  // namespace BetterSongSearch::Util
@@ -9,6 +9,7 @@
 #include "GlobalNamespace/BeatmapLevel.hpp"
 #include "song-details/shared/Data/RankedStates.hpp"
 #include "song-details/shared/Data/SongDifficulty.hpp"
+#include "DataHolder.hpp"
 #include "FilterOptions.hpp"
 #include "UI/ViewControllers/SongList.hpp"
 
@@ -19,6 +20,11 @@ namespace BetterSongSearch::Util {
 
     UnityW<UnityEngine::Sprite> getLocalCoverSync(StringW songHash);
 
+    // @brief Leaderboard whose stars are shown for a song with the given ranked states
+    SongDetailsCache::RankedStates TargetedRankLeaderboardService(
+        SongDetailsCache::RankedStates rStates, FilterTypes::RankedFilter rankedFilter, FilterTypes::PreferredLeaderBoard preferredLeaderboard
+    );
+
     SongDetailsCache::RankedStates GetTargetedRankLeaderboardService(const SongDetailsCache::SongDifficulty* diff);
 
     float getStars(const SongDetailsCache::SongDifficulty* diff, SongDetailsCache::RankedStates state);
@@ -60,6 +66,19 @@ namespace BetterSongSearch::Util {
 
     bool MeetsFilter(const SongDetailsCache::Song* song);
     bool DifficultyCheck(const SongDetailsCache::SongDifficulty* diff, const SongDetailsCache::Song* song);
+    // @param leaderboard Leaderboard whose stars the song shows (TargetedRankLeaderboardService), the same for all its difficulties
+    bool DifficultyCheck(const SongDetailsCache::SongDifficulty* diff, const SongDetailsCache::Song* song, SongDetailsCache::RankedStates leaderboard);
+    // @brief Checks the mod requirement filter for one difficulty
+    bool MeetsModRequirement(const SongDetailsCache::SongDifficulty* diff, FilterTypes::Requirement requirement);
+    // @brief Runs DifficultyCheck on every difficulty of the song and collects the stars of the passing ones
+    BetterSongSearch::DiffFilterResult EvaluateDifficulties(const SongDetailsCache::Song* song);
+    // @brief Orders the difficulties for the cell labels: unranked first, then by stars for the star sorts, then passing and standard ones first
+    // @param result Filter results of the song, nullptr to check the difficulties
+    BetterSongSearch::DiffLabelOrder OrderDifficultyLabels(
+        const SongDetailsCache::Song* song, FilterTypes::SortMode sort, const BetterSongSearch::DiffFilterResult* result
+    );
+    // @brief Checks a difficulty using the last filter pass results if there are any
+    bool DifficultyPasses(const SongDetailsCache::SongDifficulty* diff, const SongDetailsCache::Song* song);
 
     using SortFunction = std::function< float (SongDetailsCache::Song const*)>;
     extern std::unordered_map<FilterTypes::SortMode, SortFunction> sortFunctionMap;
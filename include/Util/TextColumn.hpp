@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace BetterSongSearch::Util {
+    /**
+     * Column of strings stored back to back in one buffer, indexed by song index.
+     * Used to keep the normalized search text of all songs without an allocation per string.
+     */
+    class TextColumn {
+       public:
+        void Clear() {
+            data.clear();
+            offsets.assign(1, 0);
+        }
+
+        void Reserve(std::size_t count, std::size_t bytes) {
+            offsets.reserve(count + 1);
+            data.reserve(bytes);
+        }
+
+        void Push(std::string_view text) {
+            data.append(text);
+            offsets.push_back(static_cast<uint32_t>(data.size()));
+        }
+
+        // @brief Text of the entry (no bounds check)
+        std::string_view at(std::size_t index) const {
+            return std::string_view(data).substr(offsets[index], offsets[index + 1] - offsets[index]);
+        }
+
+        std::size_t size() const {
+            return offsets.size() - 1;
+        }
+
+        std::size_t bytes() const {
+            return data.size() + offsets.size() * sizeof(uint32_t);
+        }
+
+       private:
+        std::string data;
+        std::vector<uint32_t> offsets = {0};
+    };
+}  // namespace BetterSongSearch::Util
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+namespace BetterSongSearch::Util {
+    /**
+     * Normalizes UTF-8 text for searching, appending the result to out.
+     * - ASCII letters are lowercased, digits and spaces are kept and other ASCII characters are removed (same as removeSpecialCharacter(toLower(x)))
+     * - Latin letters with diacritics are folded to their base letter (é -> e, ß -> ss), combining marks are removed
+     * - Greek and Cyrillic letters are lowercased, fullwidth ASCII is folded to ASCII
+     * - Katakana is folded to hiragana so both spellings match
+     * - Punctuation, symbols and emoji are removed, other scripts (CJK, Hangul, ...) are kept as is
+     * Pure ASCII input takes a vectorized fast path.
+     */
+    void NormalizeSearchText(std::string_view text, std::string& out);
+    std::string NormalizeSearchText(std::string_view text);
+
+    // @brief Checks if normalized text contains hiragana (katakana is already folded)
+    bool ContainsKana(std::string_view normalized);
+
+    // @brief Transliterates the hiragana in normalized text to romaji (Hepburn), other characters are kept, appending the result to out
+    void KanaToRomaji(std::string_view normalized, std::string& out);
+}  // namespace BetterSongSearch::Util
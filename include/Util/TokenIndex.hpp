@@ -0,0 +1,82 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "Util/ArtistTable.hpp"
+#include "Util/TextColumn.hpp"
+
+namespace BetterSongSearch::Util {
+    enum class SearchField : uint8_t { SongName, Artist, LevelAuthor };
+    static constexpr std::size_t SEARCH_FIELD_COUNT = 3;
+
+    struct TokenIndexParams {
+        float k1 = 1.2f;
+        float b = 0.75f;
+        std::array<float, SEARCH_FIELD_COUNT> fieldBoosts = {3.0f, 2.0f, 0.5f};
+        float proximityBonus = 1.5f;  // Added when a query word directly follows the previous one in the song name
+        float prefixFactor = 0.6f;  // Terms that only start with the query word score less than exact ones
+        std::size_t maxPrefixExpansions = 64;  // Most frequent terms used for a query word prefix
+    };
+
+    /**
+     * Inverted index over the tokens of the normalized song name, artist and level author.
+     * Ranks songs with BM25F (per field boosts) plus a proximity bonus, the top k are retrieved
+     * with MaxScore so songs that can't make it into the top k are skipped without being fully scored.
+     */
+    class TokenIndex {
+       public:
+        struct Result {
+            uint32_t songIndex;
+            float score;
+        };
+
+        // @brief Rebuilds the index, every column is by song index
+        void Build(TextColumn const& songNames, ArtistTable const& artists, TextColumn const& levelAuthors);
+        void Clear();
+
+        /**
+         * Finds the k best matching songs, best first (ties by song index)
+         * @param k SIZE_MAX ranks every match, nothing can be skipped then
+         * @param words normalized query words
+         * @param allowed bitmap by song index of songs that can be returned, nullptr for all
+         * @param out receives the results
+         */
+        void TopK(std::vector<std::string_view> const& words, std::size_t k, std::vector<uint64_t> const* allowed, std::vector<Result>& out) const;
+
+        std::size_t termCount() const {
+            return terms.size();
+        }
+
+        std::size_t bytes() const;
+
+        TokenIndexParams params;
+
+       private:
+        struct Posting {
+            uint32_t song;
+            std::array<uint8_t, SEARCH_FIELD_COUNT> tf;  // Term frequency per field (saturated)
+            uint8_t namePosition;  // First token position in the song name, 255 if not in it
+        };
+
+        // Posting of a query word, the word can expand to multiple terms
+        struct QueryPosting {
+            uint32_t song;
+            float score;
+            uint8_t namePosition;
+        };
+
+        float ScorePosting(Posting const& posting, float idf) const;
+        void CollectWordPostings(std::string_view word, std::vector<QueryPosting>& out) const;
+
+        TextColumn terms;  // Sorted, term id is the position
+        std::vector<uint32_t> termDocCount;  // Songs containing the term
+        std::vector<uint32_t> postingOffsets;  // Postings of term i are [postingOffsets[i], postingOffsets[i + 1])
+        std::vector<Posting> postings;
+        std::array<std::vector<uint8_t>, SEARCH_FIELD_COUNT> fieldLengths;  // Tokens per field by song index
+        std::array<float, SEARCH_FIELD_COUNT> averageFieldLengths = {};
+        uint32_t songCount = 0;
+    };
+}  // namespace BetterSongSearch::Util
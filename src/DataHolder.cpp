@@ -1,10 +1,18 @@
 #include "DataHolder.hpp"
 
+#include <bit>
+#include <chrono>
+#include <condition_variable>
 #include <mutex>
-#include <regex>
 #include <shared_mutex>
+#include <utility>
+#ifdef BSS_SCORE_TIMING
+#include <regex>
+#include <unordered_set>
+#endif
 
 #include "bsml/shared/BSML/MainThreadScheduler.hpp"
+#include "GlobalNamespace/BeatmapCharacteristicSO.hpp"
 #include "GlobalNamespace/PlayerData.hpp"
 #include "GlobalNamespace/PlayerDataModel.hpp"
 #include "GlobalNamespace/PlayerLevelStatsData.hpp"
@@ -14,8 +22,13 @@
 #include "song-details/shared/SongDetails.hpp"
 #include "System/Collections/Generic/Dictionary_2.hpp"
 #include "Util/CurrentTimeMs.hpp"
+#include "Util/ArtistTable.hpp"
+#include "Util/FuzzyMatch.hpp"
+#include "Util/SearchQuery.hpp"
 #include "Util/SongUtil.hpp"
+#include "Util/TextNormalize.hpp"
 #include "Util/TextUtil.hpp"
+#include "Util/TokenIndex.hpp"
 
 using namespace BetterSongSearch::Util;
 
@@ -39,23 +52,37 @@ void BetterSongSearch::DataHolder::Init() {
         dataHolder.preferredLeaderboard = FilterTypes::PreferredLeaderBoard::ScoreSaber;
         getPluginConfig().PreferredLeaderboard.SetValue("Scoresaber");
     }
+
+    std::string rankingMode = getPluginConfig().RankingMode.GetValue();
+    if (RANKING_MODE_MAP.contains(rankingMode)) {
+        dataHolder.rankingMode = RANKING_MODE_MAP.at(rankingMode);
+    } else {
+        dataHolder.rankingMode = FilterTypes::RankingMode::Classic;
+        getPluginConfig().RankingMode.SetValue("Classic");
+    }
+    dataHolder.currentRankingMode = dataHolder.rankingMode;
 }
 
 void BetterSongSearch::DataHolder::SongDataDone() {
     DEBUG("SongDataDone");
+    // Needed if songdetails is loaded in the background by other mods
+    if (this->songDetails == nullptr) {
+        this->songDetails = SongDetailsCache::SongDetails::Init().get();
+    }
+
     PreprocessTags();
-    UpdatePlayerScores();
+    PreprocessIndexes();
+    PreprocessSearchText();
+    // Cached results point to the old songs
+    InvalidateSearchCache();
+    // Song indexes changed, so the scores have to be resolved again
+    UpdatePlayerScores(true);
 
     loading = false;
     failed = false;
     loaded = true;
     needsRefresh = true;
 
-    // Needed if songdetails is loaded in the background by other mods
-    if (this->songDetails == nullptr) {
-        this->songDetails = SongDetailsCache::SongDetails::Init().get();
-    }
-
     loadingFinished.invoke();
 }
 
@@ -123,9 +150,481 @@ void BetterSongSearch::DataHolder::PreprocessTags() {
     this->tags = tags;
 }
 
-void BetterSongSearch::DataHolder::UpdatePlayerScores() {
+void BetterSongSearch::DataHolder::PreprocessIndexes() {
+    long long before = CurrentTimeMs();
+    auto& songs = songDetails->songs;
+
+    std::vector<SongHash> hashes;
+    std::vector<uint32_t> mapIds;
+    std::vector<uint32_t> diffOffsets(songs.size() + 1, 0);
+    // Same types as the comparisons in MeetsFilter so the ranges match its checks exactly
+    std::vector<uint32_t> uploadTimes;
+    std::vector<float> ratings;
+    std::vector<int> votes;
+    std::vector<float> durations;
+    hashes.resize(songs.size());
+    mapIds.reserve(songs.size());
+    quantizedColumns.Clear();
+    uploadTimes.reserve(songs.size());
+    ratings.reserve(songs.size());
+    votes.reserve(songs.size());
+    durations.reserve(songs.size());
+
+    for (std::size_t i = 0; i < songs.size(); i++) {
+        auto const& song = songs.at(i);
+        if (!DecodeHash(song.hash(), hashes[i])) {
+            WARNING("Song {} has an invalid hash", song.index);
+        }
+        mapIds.push_back(song.mapId());
+        diffOffsets[i + 1] = diffOffsets[i] + song.diffCount;
+        uploadTimes.push_back(song.uploadTimeUnix);
+        ratings.push_back(song.rating());
+        votes.push_back((int) song.upvotes + (int) song.downvotes);
+        durations.push_back((float) song.songDurationSeconds);
+
+        for (auto const& diff : song) {
+            // Same NPS as DifficultyCheck, songs without a duration have none
+            float nps = song.songDurationSeconds > 0 ? (float) diff.notes / (float) song.songDurationSeconds : -1.0f;
+            quantizedColumns.Push(diff.njs, nps, diff.starsSS, diff.starsBL);
+        }
+    }
+
+    hashIndex.Build(std::move(hashes));
+    mapIdIndex.Build(mapIds);
+    uploadTimeIndex.Build(uploadTimes);
+    ratingIndex.Build(ratings);
+    votesIndex.Build(votes);
+    durationIndex.Build(durations);
+
+    INFO("Built song indexes in {} ms (quantized columns {} KB)", CurrentTimeMs() - before, quantizedColumns.bytes() / 1024);
+
+    before = CurrentTimeMs();
+    PreprocessCategories();
+    INFO("Built category bitmaps in {} ms ({} KB)", CurrentTimeMs() - before, categories.bytes() / 1024);
+
+    // Size the score bitmaps for the new dataset, they get filled by UpdatePlayerScores
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex_songsWithScores);
+        diffBase = std::move(diffOffsets);
+        songsWithScores = std::vector<std::atomic<uint64_t>>((songs.size() + 63) / 64);
+        diffFilterResults = std::vector<DiffFilterSlot>(songs.size());
+        filterGeneration++;
+        songsWithScoresCount = 0;
+        playedDiffs = std::vector<std::atomic<uint64_t>>((diffBase.back() + 63) / 64);
+        playedDiffsCount = 0;
+    }
+
+    // Star columns are per difficulty of the old dataset, readers that still hold one keep it alive
+    {
+        std::lock_guard<std::mutex> lock(starColumnsMutex);
+        starDiffBase = std::make_shared<std::vector<uint32_t>>(diffBase);
+        for (auto& column : starColumns) {
+            std::atomic_store(&column, std::shared_ptr<StarColumn const>());
+        }
+    }
+}
+
+void BetterSongSearch::DataHolder::PreprocessCategories() {
+    auto& songs = songDetails->songs;
+
+    categories = {};
+    // Every filter value gets a bitmap, even if no song has it
+    for (auto const& [filter, state] : RANK_MAP) {
+        categories.rankedStates[filter];
+    }
+    for (auto const& [filter, characteristic] : CHARACTERISTIC_MAP) {
+        categories.characteristics[filter];
+    }
+    for (auto const& [filter, difficulty] : DIFFICULTY_MAP) {
+        categories.difficulties[filter];
+    }
+    for (auto requirement : {
+             FilterTypes::Requirement::NoodleExtensions,
+             FilterTypes::Requirement::MappingExtensions,
+             FilterTypes::Requirement::Chroma,
+             FilterTypes::Requirement::Cinema,
+             FilterTypes::Requirement::None,
+         }) {
+        categories.modRequirements[requirement];
+    }
+
+    // Songs are added in index order, which is the fast path of the bitmaps
+    for (std::size_t i = 0; i < songs.size(); i++) {
+        auto const& song = songs.at(i);
+        uint32_t songIndex = static_cast<uint32_t>(i);
+
+        uint64_t tags = song.tags;
+        while (tags != 0) {
+            categories.tags[std::countr_zero(tags)].Add(songIndex);
+            tags &= tags - 1;
+        }
+
+        if (hasFlags(song.uploadFlags, SongDetailsCache::UploadFlags::Curated)) {
+            categories.curated.Add(songIndex);
+        }
+        if (hasFlags(song.uploadFlags, SongDetailsCache::UploadFlags::VerifiedUploader)) {
+            categories.verifiedMappers.Add(songIndex);
+        }
+        if (hasFlags(song.uploadFlags, SongDetailsCache::UploadFlags::HasV3Environment)) {
+            categories.v3Environment.Add(songIndex);
+        }
+
+        for (auto& [filter, bitmap] : categories.rankedStates) {
+            if (hasFlags(song.rankedStates, RANK_MAP.at(filter))) {
+                bitmap.Add(songIndex);
+            }
+        }
+
+        for (auto const& diff : song) {
+            for (auto& [filter, bitmap] : categories.characteristics) {
+                if (diff.characteristic == CHARACTERISTIC_MAP.at(filter)) {
+                    bitmap.Add(songIndex);
+                }
+            }
+            for (auto& [filter, bitmap] : categories.difficulties) {
+                if (diff.difficulty == DIFFICULTY_MAP.at(filter)) {
+                    bitmap.Add(songIndex);
+                }
+            }
+            for (auto& [requirement, bitmap] : categories.modRequirements) {
+                if (MeetsModRequirement(&diff, requirement)) {
+                    bitmap.Add(songIndex);
+                }
+            }
+        }
+
+        categories.uploaders[removeSpecialCharacter(toLower(song.uploaderName()))].Add(songIndex);
+    }
+}
+
+std::size_t BetterSongSearch::CategoryBitmaps::bytes() const {
+    std::size_t total = 0;
+    for (auto const& bitmap : tags) {
+        total += bitmap.bytes();
+    }
+    total += curated.bytes() + verifiedMappers.bytes() + v3Environment.bytes();
+    for (auto const& [key, bitmap] : rankedStates) {
+        total += bitmap.bytes();
+    }
+    for (auto const& [key, bitmap] : characteristics) {
+        total += bitmap.bytes();
+    }
+    for (auto const& [key, bitmap] : difficulties) {
+        total += bitmap.bytes();
+    }
+    for (auto const& [key, bitmap] : modRequirements) {
+        total += bitmap.bytes();
+    }
+    for (auto const& [name, bitmap] : uploaders) {
+        total += name.capacity() + bitmap.bytes();
+    }
+    return total;
+}
+
+bool BetterSongSearch::DataHolder::CategoryCandidates(FilterProfile const& filter, RoaringBitmap& songs) const {
+    bool any = false;
+    auto intersect = [&any, &songs](RoaringBitmap const& bitmap) {
+        if (!any) {
+            songs = bitmap;
+            any = true;
+        } else {
+            songs &= bitmap;
+        }
+    };
+    auto tagsUnion = [this](uint64_t bitfield) {
+        RoaringBitmap result;
+        while (bitfield != 0) {
+            result |= this->categories.tags[std::countr_zero(bitfield)];
+            bitfield &= bitfield - 1;
+        }
+        return result;
+    };
+
+    if (filter.onlyCuratedMaps) {
+        intersect(categories.curated);
+    }
+    if (filter.onlyVerifiedMappers) {
+        intersect(categories.verifiedMappers);
+    }
+    if (filter.onlyV3Maps) {
+        intersect(categories.v3Environment);
+    }
+    if (filter._mapStyleBitfield != 0) {
+        intersect(tagsUnion(filter._mapStyleBitfield));
+    }
+    if (filter._mapGenreBitfield != 0) {
+        intersect(tagsUnion(filter._mapGenreBitfield));
+    }
+
+    auto rankedFilter = static_cast<FilterTypes::RankedFilter>(filter.rankedType);
+    if (auto it = categories.rankedStates.find(rankedFilter); it != categories.rankedStates.end()) {
+        intersect(it->second);
+    }
+    auto charFilter = static_cast<FilterTypes::CharFilter>(filter.charFilter);
+    if (auto it = categories.characteristics.find(charFilter); it != categories.characteristics.end()) {
+        intersect(it->second);
+    }
+    auto difficultyFilter = static_cast<FilterTypes::DifficultyFilter>(filter.difficultyFilter);
+    if (auto it = categories.difficulties.find(difficultyFilter); it != categories.difficulties.end()) {
+        intersect(it->second);
+    }
+    auto modRequirement = static_cast<FilterTypes::Requirement>(filter.modRequirement);
+    if (auto it = categories.modRequirements.find(modRequirement); it != categories.modRequirements.end()) {
+        intersect(it->second);
+    }
+
+    RoaringBitmap listedUploaders;
+    for (auto const& uploader : filter.uploaders) {
+        if (auto it = categories.uploaders.find(uploader); it != categories.uploaders.end()) {
+            listedUploaders |= it->second;
+        }
+    }
+    if (!filter.uploaders.empty() && !filter.uploadersBlackList) {
+        intersect(listedUploaders);
+    }
+
+    // Exclusions need a set to remove from, without one MeetsFilter checks them
+    if (any) {
+        if (filter._mapGenreExcludeBitfield != 0) {
+            songs -= tagsUnion(filter._mapGenreExcludeBitfield);
+        }
+        if (filter.uploadersBlackList) {
+            songs -= listedUploaders;
+        }
+    }
+    return any;
+}
+
+void BetterSongSearch::DataHolder::PreprocessSearchText() {
+    long long before = CurrentTimeMs();
+    auto& songs = songDetails->songs;
+
+    songNames.Clear();
+    songNamesRomaji.Clear();
+    artists.Clear();
+    levelAuthorNames.Clear();
+    songNames.Reserve(songs.size(), songs.size() * 24);
+    songNamesRomaji.Reserve(songs.size(), 0);
+    levelAuthorNames.Reserve(songs.size(), songs.size() * 12);
+
+    // Reused buffers so normalizing does not allocate per song
+    std::string normalized;
+    std::string romaji;
+    std::size_t romajiCount = 0;
+    for (std::size_t i = 0; i < songs.size(); i++) {
+        auto const& song = songs.at(i);
+
+        normalized.clear();
+        NormalizeSearchText(song.songName(), normalized);
+        songNames.Push(normalized);
+
+        romaji.clear();
+        if (ContainsKana(normalized)) {
+            KanaToRomaji(normalized, romaji);
+            romajiCount++;
+        }
+        songNamesRomaji.Push(romaji);
+
+        normalized.clear();
+        NormalizeSearchText(song.songAuthorName(), normalized);
+        artists.Add(normalized);
+
+        normalized.clear();
+        NormalizeSearchText(song.levelAuthorName(), normalized);
+        levelAuthorNames.Push(normalized);
+    }
+
+    artists.Finish();
+
+    INFO(
+        "Normalized search text in {} ms ({} KB, {} romaji names, {} artists)",
+        CurrentTimeMs() - before,
+        (songNames.bytes() + songNamesRomaji.bytes() + artists.bytes() + levelAuthorNames.bytes()) / 1024,
+        romajiCount,
+        artists.size()
+    );
+
+    before = CurrentTimeMs();
+    tokenIndex.Build(songNames, artists, levelAuthorNames);
+    INFO("Built token index in {} ms ({} terms, {} KB)", CurrentTimeMs() - before, tokenIndex.termCount(), tokenIndex.bytes() / 1024);
+}
+
+// Narrowest range has to leave out at least this fraction of the songs, otherwise scanning all songs is as fast
+static constexpr std::size_t RANGE_CANDIDATES_MAX_FRACTION = 2;
+// Other ranges are only intersected if they are at most this many times bigger than the narrowest one
+static constexpr std::size_t RANGE_INTERSECT_MAX_RATIO = 4;
+
+bool BetterSongSearch::DataHolder::RangeCandidates(FilterProfile const& filter, std::vector<uint32_t>& candidates) const {
+    std::size_t totalSongs = this->uploadTimeIndex.size();
+    if (totalSongs == 0) {
+        return false;
+    }
+
+    std::array<std::span<uint32_t const>, 4> ranges = {
+        this->uploadTimeIndex.AtLeast(filter.minUploadDate),
+        this->ratingIndex.AtLeast(filter.minRating),
+        this->votesIndex.AtLeast(filter.minVotes),
+        this->durationIndex.Between(filter.minLength, filter.maxLength),
+    };
+    std::sort(ranges.begin(), ranges.end(), [](auto const& a, auto const& b) {
+        return a.size() < b.size();
+    });
+    if (ranges[0].size() > totalSongs / RANGE_CANDIDATES_MAX_FRACTION) {
+        return false;
+    }
+
+    std::vector<uint64_t> bitmap((totalSongs + 63) / 64, 0);
+    for (uint32_t songIndex : ranges[0]) {
+        bitmap[songIndex / 64] |= 1ull << (songIndex % 64);
+    }
+
+    // Intersecting costs the size of the range, so it stays proportional to the narrowest one
+    std::vector<uint64_t> rangeBitmap;
+    for (std::size_t r = 1; r < ranges.size(); r++) {
+        if (ranges[r].size() == totalSongs || ranges[r].size() > ranges[0].size() * RANGE_INTERSECT_MAX_RATIO) {
+            break;
+        }
+        rangeBitmap.assign(bitmap.size(), 0);
+        for (uint32_t songIndex : ranges[r]) {
+            rangeBitmap[songIndex / 64] |= 1ull << (songIndex % 64);
+        }
+        for (std::size_t w = 0; w < bitmap.size(); w++) {
+            bitmap[w] &= rangeBitmap[w];
+        }
+    }
+
+    candidates.clear();
+    for (std::size_t w = 0; w < bitmap.size(); w++) {
+        uint64_t word = bitmap[w];
+        while (word != 0) {
+            candidates.push_back(static_cast<uint32_t>(w * 64 + std::countr_zero(word)));
+            word &= word - 1;
+        }
+    }
+    return true;
+}
+
+SongDetailsCache::Song const* BetterSongSearch::DataHolder::FindSongByHash(std::string_view hash) {
+    if (songDetails == nullptr) {
+        return nullptr;
+    }
+    uint32_t songIndex = hashIndex.Find(hash);
+    if (songIndex == SongHashIndex::npos || songIndex >= songDetails->songs.size()) {
+        return nullptr;
+    }
+    return &songDetails->songs.at(songIndex);
+}
+
+static SongDetailsCache::MapCharacteristic CharacteristicFromSerializedName(std::u16string_view name) {
+    if (name == u"Standard") {
+        return SongDetailsCache::MapCharacteristic::Standard;
+    }
+    if (name == u"OneSaber") {
+        return SongDetailsCache::MapCharacteristic::OneSaber;
+    }
+    if (name == u"NoArrows") {
+        return SongDetailsCache::MapCharacteristic::NoArrows;
+    }
+    if (name == u"90Degree") {
+        return SongDetailsCache::MapCharacteristic::NinetyDegree;
+    }
+    if (name == u"360Degree") {
+        return SongDetailsCache::MapCharacteristic::ThreeSixtyDegree;
+    }
+    if (name == u"Lightshow") {
+        return SongDetailsCache::MapCharacteristic::LightShow;
+    }
+    if (name == u"Lawless") {
+        return SongDetailsCache::MapCharacteristic::Lawless;
+    }
+    return SongDetailsCache::MapCharacteristic::Custom;
+}
+
+// Bitmaps to mark scored levels in
+struct ScoreBitmaps {
+    std::vector<uint32_t> const& diffBase;
+    std::vector<std::atomic<uint64_t>>& songs;  // By song index
+    std::vector<std::atomic<uint64_t>>& diffs;  // By global difficulty index
+    std::size_t newSongs = 0;
+    std::size_t newDiffs = 0;
+};
+
+// The filter pass reads the words while they are marked, relaxed is enough for single bits
+static bool MarkBit(std::atomic<uint64_t>& word, uint64_t bit) {
+    return (word.fetch_or(bit, std::memory_order_relaxed) & bit) == 0;
+}
+
+// Resolves a level stats entry to the song it scores and marks the song and the played difficulties, without allocating
+// @return Song index or npos if the entry has no valid score for a song in the dataset
+static uint32_t MarkScoredLevel(GlobalNamespace::PlayerLevelStatsData* x, ScoreBitmaps& bitmaps) {
+    static constexpr std::u16string_view customLevelPrefix = u"custom_level_";
+
+    if (!x->get_validScore() || x->get_highScore() == 0) {
+        return SongHashIndex::npos;
+    }
+    std::u16string_view levelid = x->get_levelID();
+    if (levelid.size() < customLevelPrefix.size() + 40 || !levelid.starts_with(customLevelPrefix)) {
+        return SongHashIndex::npos;
+    }
+
+    SongHash hash;
+    if (!DecodeHash(levelid.substr(customLevelPrefix.size(), 40), hash)) {
+        return SongHashIndex::npos;
+    }
+
+    uint32_t songIndex = dataHolder.hashIndex.Find(hash);
+    if (songIndex == SongHashIndex::npos || songIndex / 64 >= bitmaps.songs.size() || songIndex >= bitmaps.diffBase.size()) {
+        return SongHashIndex::npos;
+    }
+
+    auto difficulty = SongDetailsCache::MapDifficulty((int) x->____difficulty.value__);
+    // Without a characteristic only the difficulty can be matched
+    bool anyCharacteristic = true;
+    auto characteristic = SongDetailsCache::MapCharacteristic::Custom;
+    if (auto characteristicSO = x->get_beatmapCharacteristic()) {
+        anyCharacteristic = false;
+        characteristic = CharacteristicFromSerializedName(characteristicSO->get_serializedName());
+    }
+
+    auto const& song = dataHolder.songDetails->songs.at(songIndex);
+    uint32_t diffIndex = bitmaps.diffBase[songIndex];
+    bool matched = false;
+    for (auto const& diff : song) {
+        if (diff.difficulty == difficulty && (anyCharacteristic || diff.characteristic == characteristic)) {
+            matched = true;
+            if (diffIndex / 64 < bitmaps.diffs.size() && MarkBit(bitmaps.diffs[diffIndex / 64], 1ull << (diffIndex % 64))) {
+                bitmaps.newDiffs++;
+            }
+        }
+        diffIndex++;
+    }
+    if (!matched) {
+        return SongHashIndex::npos;
+    }
+
+    if (MarkBit(bitmaps.songs[songIndex / 64], 1ull << (songIndex % 64))) {
+        bitmaps.newSongs++;
+    }
+    return songIndex;
+}
+
+// Copies the words of a scanned bitmap into the live one of the same size
+// @return True if any word changed
+static bool CopyBitmap(std::vector<std::atomic<uint64_t>> const& from, std::vector<std::atomic<uint64_t>>& to) {
+    bool changed = false;
+    for (std::size_t i = 0; i < from.size(); i++) {
+        uint64_t word = from[i].load(std::memory_order_relaxed);
+        if (to[i].exchange(word, std::memory_order_relaxed) != word) {
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+void BetterSongSearch::DataHolder::UpdatePlayerScores(bool force) {
     static std::atomic_bool updating = false;  // Prevent multiple checks at once
-    if (updating) {
+    // After the first full scan scores are kept up to date by UpdatePlayerScore
+    if (updating || (scoresLoaded && !force)) {
         return;
     }
     updating = true;
@@ -164,53 +663,52 @@ void BetterSongSearch::DataHolder::UpdatePlayerScores() {
 
             auto statsDataEnumerator = statsData->GetEnumerator();
 
-            std::unordered_set<std::string> songsWithScoresTemp;
+            // Scan into copies so the filter pass never sees a half built bitmap
+            std::vector<uint32_t> diffBaseTemp;
+            std::vector<std::atomic<uint64_t>> songsWithScoresTemp;
+            std::vector<std::atomic<uint64_t>> playedDiffsTemp;
+            {
+                std::shared_lock<std::shared_mutex> lock(mutex_songsWithScores);
+                diffBaseTemp = diffBase;
+                songsWithScoresTemp = std::vector<std::atomic<uint64_t>>(songsWithScores.size());
+                playedDiffsTemp = std::vector<std::atomic<uint64_t>>(playedDiffs.size());
+            }
+            ScoreBitmaps bitmaps{diffBaseTemp, songsWithScoresTemp, playedDiffsTemp};
+            std::size_t checkedCount = 0;
 
             while (statsDataEnumerator.MoveNext()) {
-                auto statsDataKeys = statsDataEnumerator.get_Current();
-                auto x = statsDataKeys.value;
-
-                if (!x->get_validScore() || x->get_highScore() == 0 || x->get_levelID()->get_Length() < 13 + 40) {
-                    continue;
-                }
-                std::u16string_view levelid = x->get_levelID();
-                if (!levelid.starts_with(u"custom_level_")) {
-                    continue;
-                };
-                auto sh = std::regex_replace((std::string) x->get_levelID(), std::basic_regex("custom_level_"), "");
-
-                auto& song = dataHolder.songDetails->songs.FindByHash(sh);
-
-                if (song == SongDetailsCache::Song::none) {
-                    continue;
-                }
-
-                bool foundDiff = false;
-
-                for (auto& diff : song) {
-                    if (diff.difficulty == SongDetailsCache::MapDifficulty((int) x->____difficulty.value__)) {
-                        foundDiff = true;
-                        break;
-                    }
-                }
-                if (!foundDiff) {
-                    continue;
-                }
-
-                songsWithScoresTemp.insert(sh);
+                checkedCount++;
+                MarkScoredLevel(statsDataEnumerator.get_Current().value, bitmaps);
             }
-            INFO("local scores checked. found {}", songsWithScoresTemp.size());
+            std::size_t foundCount = bitmaps.newSongs;
+            INFO("local scores checked. found {} songs, {} difficulties", foundCount, bitmaps.newDiffs);
 
             std::unique_lock<std::shared_mutex> lock(mutex_songsWithScores);
-            bool firstLoad = songsWithScores.empty() && songsWithScoresTemp.size() > 0;
-            bool isChanged = songsWithScores.size() != songsWithScoresTemp.size();
-            bool isEmpty = songsWithScoresTemp.empty() && songsWithScores.empty();
-            songsWithScoresTemp.swap(songsWithScores);
+            if (diffBase != diffBaseTemp) {
+                // The dataset was replaced while scanning, the result is for the old song indexes
+                lock.unlock();
+                WARNING("Song data changed while updating player scores, scanning again");
+                updating = false;
+                UpdatePlayerScores(true);
+                return;
+            }
+            bool firstLoad = songsWithScoresCount == 0 && foundCount > 0;
+            // Same sizes, so copy in place to keep lock free readers valid
+            bool isChanged = CopyBitmap(songsWithScoresTemp, songsWithScores);
+            isChanged = CopyBitmap(playedDiffsTemp, playedDiffs) || isChanged;
+            bool isEmpty = foundCount == 0 && songsWithScoresCount == 0;
+            songsWithScoresCount = foundCount;
+            playedDiffsCount = bitmaps.newDiffs;
+            scoresLoaded = true;
             lock.unlock();
 
             updating = false;
 
-            INFO("Updated player scores in {} ms", CurrentTimeMs() - before);
+            INFO("Updated player scores in {} ms ({} level stats, full scan)", CurrentTimeMs() - before, checkedCount);
+
+            if (isChanged) {
+                InvalidateSearchCache();
+            }
 
             if (isChanged && !isEmpty) {
                 BSML::MainThreadScheduler::Schedule([this, firstLoad] {
@@ -218,6 +716,7 @@ void BetterSongSearch::DataHolder::UpdatePlayerScores() {
                     // Make another search if we have the filter set and run the first time
                     {
                         if (firstLoad && !this->searchInProgress && this->filterOptions.getLocalScoreType() != FilterTypes::LocalScoreFilter::All) {
+                            this->forceReload = true;
                             this->Search();
                         }
                     }
@@ -230,16 +729,158 @@ void BetterSongSearch::DataHolder::UpdatePlayerScores() {
     });
 }
 
+void BetterSongSearch::DataHolder::UpdatePlayerScore(GlobalNamespace::PlayerLevelStatsData* stats) {
+    if (!stats || !this->songDetails || !this->songDetails->songs.get_isDataAvailable()) {
+        return;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(mutex_songsWithScores);
+    ScoreBitmaps bitmaps{diffBase, songsWithScores, playedDiffs};
+    uint32_t songIndex = MarkScoredLevel(stats, bitmaps);
+    if (songIndex == SongHashIndex::npos || bitmaps.newDiffs == 0) {
+        return;
+    }
+    songsWithScoresCount += bitmaps.newSongs;
+    playedDiffsCount += bitmaps.newDiffs;
+    lock.unlock();
+
+    DEBUG("Song {} got a score on {} new difficulties", songIndex, bitmaps.newDiffs);
+    InvalidateSearchCache();
+
+    // Results filtered by local scores are stale now, refresh them when the list is shown again
+    if (this->filterOptions.getLocalScoreType() != FilterTypes::LocalScoreFilter::All) {
+        this->needsRefresh = true;
+    }
+    playerDataLoaded.invoke();
+}
+
+#ifdef BSS_SCORE_TIMING
+std::size_t BetterSongSearch::DataHolder::LegacyScoreScan() {
+    if (!playerDataModel || !playerDataModel->get_playerData() || !playerDataModel->get_playerData()->get_levelsStatsData()) {
+        return 0;
+    }
+    std::unordered_set<std::string> songsWithScoresTemp;
+    auto statsDataEnumerator = playerDataModel->get_playerData()->get_levelsStatsData()->GetEnumerator();
+    while (statsDataEnumerator.MoveNext()) {
+        auto x = statsDataEnumerator.get_Current().value;
+        if (!x->get_validScore() || x->get_highScore() == 0 || x->get_levelID()->get_Length() < 13 + 40) {
+            continue;
+        }
+        std::u16string_view levelid = x->get_levelID();
+        if (!levelid.starts_with(u"custom_level_")) {
+            continue;
+        }
+        auto sh = std::regex_replace((std::string) x->get_levelID(), std::basic_regex("custom_level_"), "");
+        auto song = FindSongByHash(sh);
+        if (song == nullptr) {
+            continue;
+        }
+        for (auto& diff : *song) {
+            if (diff.difficulty == SongDetailsCache::MapDifficulty((int) x->____difficulty.value__)) {
+                songsWithScoresTemp.insert(sh);
+                break;
+            }
+        }
+    }
+    return songsWithScoresTemp.size();
+}
+#endif
+
 bool BetterSongSearch::DataHolder::SongHasScore(std::string_view songhash) {
-    std::shared_lock<std::shared_mutex> lock(mutex_songsWithScores);
-    if (this->songsWithScores.empty()) {
+    uint32_t songIndex = this->hashIndex.Find(songhash);
+    if (songIndex == SongHashIndex::npos) {
         return false;
     }
-    return this->songsWithScores.contains(songhash.data());
+    return SongHasScore(songIndex);
 }
 
 bool BetterSongSearch::DataHolder::SongHasScore(SongDetailsCache::Song const* song) {
-    return SongHasScore(song->hash());
+    return SongHasScore(static_cast<uint32_t>(song->index));
+}
+
+bool BetterSongSearch::DataHolder::SongHasScore(uint32_t songIndex) {
+    // No lock, see mutex_songsWithScores
+    if (songIndex / 64 >= this->songsWithScores.size()) {
+        return false;
+    }
+    return (this->songsWithScores[songIndex / 64].load(std::memory_order_relaxed) >> (songIndex % 64)) & 1;
+}
+
+std::optional<BetterSongSearch::DiffFilterResult> BetterSongSearch::DataHolder::GetDiffFilterResult(SongDetailsCache::Song const* song) const {
+    if (song->index >= diffFilterResults.size()) {
+        return std::nullopt;
+    }
+    auto const& slot = diffFilterResults[song->index];
+    uint32_t stamp = filterGeneration.load(std::memory_order_relaxed) * 2;
+    if (slot.stamp.load(std::memory_order_acquire) != stamp) {
+        return std::nullopt;
+    }
+    DiffFilterResult result;
+    result.passingDiffs = slot.passingDiffs.load(std::memory_order_relaxed);
+    uint64_t stars = slot.stars.load(std::memory_order_relaxed);
+    result.minStars = std::bit_cast<float>(static_cast<uint32_t>(stars));
+    result.maxStars = std::bit_cast<float>(static_cast<uint32_t>(stars >> 32));
+    result.anyPasses = slot.anyPasses.load(std::memory_order_relaxed);
+    // Rewritten while copying, the caller checks the difficulties itself then
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.stamp.load(std::memory_order_relaxed) != stamp) {
+        return std::nullopt;
+    }
+    return result;
+}
+
+void BetterSongSearch::DataHolder::SetDiffFilterResult(uint32_t songIndex, DiffFilterResult const& result) {
+    if (songIndex >= diffFilterResults.size()) {
+        return;
+    }
+    auto& slot = diffFilterResults[songIndex];
+    uint32_t stamp = filterGeneration.load(std::memory_order_relaxed) * 2;
+    slot.stamp.store(stamp + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.passingDiffs.store(result.passingDiffs, std::memory_order_relaxed);
+    uint64_t stars = std::bit_cast<uint32_t>(result.minStars) | (static_cast<uint64_t>(std::bit_cast<uint32_t>(result.maxStars)) << 32);
+    slot.stars.store(stars, std::memory_order_relaxed);
+    slot.anyPasses.store(result.anyPasses, std::memory_order_relaxed);
+    slot.stamp.store(stamp, std::memory_order_release);
+}
+
+std::optional<BetterSongSearch::DiffLabelOrder> BetterSongSearch::DataHolder::GetDiffLabelOrder(SongDetailsCache::Song const* song) const {
+    if (song->index >= diffFilterResults.size()) {
+        return std::nullopt;
+    }
+    auto const& slot = diffFilterResults[song->index];
+    uint32_t stamp = labelGeneration.load(std::memory_order_relaxed) * 2;
+    if (slot.labelStamp.load(std::memory_order_acquire) != stamp) {
+        return std::nullopt;
+    }
+    DiffLabelOrder order;
+    uint64_t diffs = slot.labelDiffs.load(std::memory_order_relaxed);
+    order.count = slot.labelCount.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.labelStamp.load(std::memory_order_relaxed) != stamp) {
+        return std::nullopt;
+    }
+    for (std::size_t i = 0; i < DiffLabelOrder::MAX_LABELS; i++) {
+        order.diffs[i] = static_cast<uint8_t>(diffs >> (i * 8));
+    }
+    return order;
+}
+
+void BetterSongSearch::DataHolder::SetDiffLabelOrder(uint32_t songIndex, DiffLabelOrder const& order) {
+    if (songIndex >= diffFilterResults.size()) {
+        return;
+    }
+    auto& slot = diffFilterResults[songIndex];
+    uint64_t diffs = 0;
+    for (std::size_t i = 0; i < DiffLabelOrder::MAX_LABELS; i++) {
+        diffs |= static_cast<uint64_t>(order.diffs[i]) << (i * 8);
+    }
+    uint32_t stamp = labelGeneration.load(std::memory_order_relaxed) * 2;
+    slot.labelStamp.store(stamp + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.labelDiffs.store(diffs, std::memory_order_relaxed);
+    slot.labelCount.store(order.count, std::memory_order_relaxed);
+    slot.labelStamp.store(stamp, std::memory_order_release);
 }
 
 void BetterSongSearch::DataHolder::SongListUIDone() {
@@ -252,6 +893,281 @@ struct xd {
     float sortWeight;
 };
 
+// Lets the search thread wait for its workers and wake up in between to publish their progress
+struct WorkerGroup {
+    std::mutex mutex;
+    std::condition_variable finished;
+    int running = 0;
+
+    void Finish() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            running--;
+        }
+        finished.notify_all();
+    }
+
+    // @return True if all workers are done, false if the timeout passed first
+    bool WaitFor(long long ms) {
+        std::unique_lock<std::mutex> lock(mutex);
+        return finished.wait_for(lock, std::chrono::milliseconds(ms), [this] {
+            return running == 0;
+        });
+    }
+};
+
+// Only the star sorts order the labels differently
+static int LabelSortClass(FilterTypes::SortMode sort) {
+    if (sort == FilterTypes::SortMode::Most_Stars) {
+        return 1;
+    }
+    if (sort == FilterTypes::SortMode::Least_Stars) {
+        return 2;
+    }
+    return 0;
+}
+
+void BetterSongSearch::DataHolder::OrderDiffLabels(std::vector<SongDetailsCache::Song const*> const& songs, FilterTypes::SortMode sort) {
+    long long before = CurrentTimeMs();
+    this->labelGeneration++;
+    this->_labelSortClass = LabelSortClass(sort);
+
+    int const num_threads = 4;
+    std::thread t[num_threads];
+    std::atomic_size_t index = 0;
+    for (int i = 0; i < num_threads; ++i) {
+        t[i] = std::thread([this, &index, &songs, sort]() {
+            std::size_t i = index++;
+            while (i < songs.size()) {
+                auto song = songs[i];
+                auto result = GetDiffFilterResult(song);
+                SetDiffLabelOrder(song->index, OrderDifficultyLabels(song, sort, result ? &*result : nullptr));
+                i = index++;
+            }
+        });
+    }
+    for (int i = 0; i < num_threads; ++i) {
+        t[i].join();
+    }
+    DEBUG("Ordered the difficulty labels of {} songs in {} ms", songs.size(), CurrentTimeMs() - before);
+}
+
+// Total order of the results so a partial sort gives the same first page as a full sort
+template <typename Ranked>
+static bool RankedBefore(Ranked const& a, Ranked const& b) {
+    if (a.weight != b.weight) {
+        return a.weight > b.weight;
+    }
+    if (a.tieWeight != b.tieWeight) {
+        return a.tieWeight > b.tieWeight;
+    }
+    return a.song->index < b.song->index;
+}
+
+// Result of matching the query against one artist, the same for all songs of the artist
+struct ArtistMatch {
+    float weight = 0;
+    int startWord = 0;  // The first word is skipped when the whole query starts with the author
+    int consumedWord = -1;  // Word that matched the author, it is not matched against the song name
+};
+
+// Calculates the author part of the legacy (PC compatible) search weight
+static ArtistMatch MatchArtist(std::string_view songAuthorName, uint32_t artistId, SearchQuery const& query) {
+    std::string_view currentSearch = query.text();
+    auto const& words = query.tokens();
+    ArtistMatch result;
+    bool matchedAuthor = false;
+
+    // Find full match author name
+    int authorFullMatch = currentSearch.find(songAuthorName);
+
+    // set up i for the loop
+    int i = 0;
+
+    if (songAuthorName.length() > 4 && authorFullMatch != std::string::npos &&
+        // Checks if there is a space after the supposedly matched author name
+        (currentSearch.length() == songAuthorName.length() || IsSpace(currentSearch[songAuthorName.length()]))) {
+        matchedAuthor = true;
+        result.weight += songAuthorName.length() > 5 ? 25 : 20;
+
+        // If the author is matched and is the first, then skip first word (i + 1)
+        // This is super cheapskate - I'd have to replace the author from the filter and recreate the words array otherwise
+        if (authorFullMatch == 0) {
+            i = 1;
+        }
+    }
+    result.startWord = i;
+
+    // If author name is empty or already matched there is nothing else to do
+    if (songAuthorName.length() == 0 || matchedAuthor) {
+        return result;
+    }
+
+    // The first word that matches the author is used for it
+    for (; i < words.size(); i++) {
+        // If the word matches the author 1:1 thats cool innit
+        if (words[i].artistId == artistId) {
+            // 3*length of the word divided by 2? wtf
+            result.weight += 3.0f * ((float) words[i].text.length() / 2.0f);
+            result.consumedWord = i;
+            break;
+            // Otherwise we'll have to check if its contained within this word
+        } else if (words[i].text.length() >= 3) {
+            int index = songAuthorName.find(words[i].text);
+
+            // If found in the beginning or is space at the end of author name which means we matched the beginning of
+            // a word
+            if (index == 0 || (index > 0 && IsSpace(songAuthorName[index - 1]))) {
+                // Add weight
+                result.weight += (int) round((index == 0 ? 4.0f : 3.0f) * ((float) words[i].text.length() / songAuthorName.length()));
+                result.consumedWord = i;
+                break;
+            }
+        }
+    }
+
+    return result;
+}
+
+// Matches the query against every artist once, indexed by artist id
+static std::vector<ArtistMatch> MatchArtists(ArtistTable const& artists, SearchQuery const& query) {
+    std::vector<ArtistMatch> matches(artists.size());
+    for (uint32_t artistId = 0; artistId < artists.size(); artistId++) {
+        matches[artistId] = MatchArtist(artists.Name(artistId), artistId, query);
+    }
+    return matches;
+}
+
+// Calculates the legacy (PC compatible) search weight of a song, 0 means no match
+// @param artistMatch result of MatchArtist for the artist of the song
+static float CalculateSearchWeight(SongDetailsCache::Song const* songe, SearchQuery const& query, ArtistMatch const& artistMatch) {
+    auto const& words = query.tokens();
+    float resultWeight = artistMatch.weight;
+    int prevMatchIndex = -1;
+
+    std::string_view songName = dataHolder.songNames.at(songe->index);
+    std::string_view songNameRomaji = dataHolder.songNamesRomaji.at(songe->index);
+    std::string_view levelAuthorName = dataHolder.levelAuthorNames.at(songe->index);
+
+    // Go over a list of words
+    int i = artistMatch.startWord;
+    for (; i < words.size(); i++) {
+        if (i == artistMatch.consumedWord) {
+            continue;
+        }
+
+        // Names written in kana can also be matched by their romaji
+        std::string_view matchName = songName;
+        int matchpos = songName.find(words[i].text);
+        if (matchpos == std::string::npos && !songNameRomaji.empty()) {
+            matchName = songNameRomaji;
+            matchpos = matchName.find(words[i].text);
+        }
+        if (matchpos != std::string::npos) {
+            // Check if we matched the beginning of a word
+            bool wordStart = matchpos == 0 || matchName[matchpos - 1] == ' ';
+
+            // If it was the beginning add 5 weighting, else 3
+            resultWeight += wordStart ? 5 : 3;
+
+            ///////////////// New algo  /////////////////////////
+            // Find the position in the name
+            int posInName = matchpos + words[i].text.length();
+
+            /*
+             * Check if we are at the end of the song name, but only if it has at least 8 characters
+             * We do this because otherwise, when searching for "lowermost revolt", songs where the
+             * songName is exactly "lowermost revolt" would have a lower result weight than
+             * "lowermost revolt (JoeBama cover)"
+             *
+             * The 8 character limitation for this is so that super short words like "those" dont end
+             * up triggering this
+             */
+            if (matchName.length() >= 6 && matchName.length() == posInName) {
+                resultWeight += 3;
+            } else {
+                // If we did match the beginning, check if we matched an entire word. Get the end index as indicated by
+                // our needle
+                bool maybeWordEnd = wordStart && posInName < matchName.length();
+
+                // Check if we actually end up at a non word char, if so add 2 weighting
+                if (maybeWordEnd && matchName[matchpos + words[i].text.length()] == ' ') {
+                    resultWeight += 2;
+                }
+            }
+            /////////////////////////////////////////////////////
+
+            //// Old algo for testing pc compatibility (comment out new algo and uncomment this for comparison with PC)
+            /////////////
+            // bool maybeWordEnd = wordStart && matchpos + words[i].length() < songName.length();
+
+            // // Check if we actually end up at a non word char, if so add 2 weighting
+            // if(maybeWordEnd && songName[matchpos + words[i].length()] == ' ')
+            //     resultWeight += 2;
+            ////////////////////////////////////////////////////
+
+            // If the word we just checked is behind the previous matched, add another 1 weight
+            if (prevMatchIndex != -1 && matchpos > prevMatchIndex) {
+                resultWeight += 1;
+            }
+
+            prevMatchIndex = matchpos;
+        }
+    }
+
+    for (i = 0; i < words.size(); i++) {
+        if (words[i].text.length() > 3 && levelAuthorName.find(words[i].text) != std::string::npos) {
+            resultWeight += 1;
+            break;
+        }
+    }
+
+    return resultWeight;
+}
+
+// Fuzzy matching only runs when the exact scorer finds less results than this
+static constexpr std::size_t FUZZY_SEARCH_MIN_RESULTS = 10;
+// Only this many results are ordered before the list is published, the table shows less than that
+static constexpr std::size_t SEARCH_FIRST_PAGE_SIZE = 64;
+// Relevance searches only rank this many results, scrolling to the end ranks RELEVANCE_RESULTS_GROWTH times more
+static constexpr std::size_t RELEVANCE_FIRST_RESULTS = 256;
+static constexpr std::size_t RELEVANCE_RESULTS_GROWTH = 4;
+// While the workers are still filtering or scoring, what they have so far is published this often
+static constexpr long long SEARCH_STREAMING_INTERVAL_MS = 80;
+// Songs of the previous list kept to compare with the new one, more than anyone scrolls through
+static constexpr std::size_t DISPLAYED_DIFF_MAX_SIZE = 4096;
+
+struct FuzzyWord {
+    std::string_view text;
+    FuzzyPattern pattern;
+    int maxDistance;
+};
+
+// Second tier scorer, typo tolerant match of every query word against the song name and author
+// @return 0 if any word is not found within its allowed edit distance
+static float CalculateFuzzySearchWeight(SongDetailsCache::Song const* songe, std::vector<FuzzyWord> const& words) {
+    std::string_view songName = dataHolder.songNames.at(songe->index);
+    std::string_view songAuthorName = dataHolder.artists.Name(dataHolder.artists.ArtistOf(songe->index));
+
+    float resultWeight = 0;
+    for (auto const& word : words) {
+        if (songName.find(word.text) != std::string_view::npos || songAuthorName.find(word.text) != std::string_view::npos) {
+            resultWeight += 2;
+            continue;
+        }
+        if (word.maxDistance == 0) {
+            return 0;
+        }
+
+        int distance = std::min(word.pattern.Distance(songName, word.maxDistance), word.pattern.Distance(songAuthorName, word.maxDistance));
+        if (distance > word.maxDistance) {
+            return 0;
+        }
+        resultWeight += distance == 1 ? 1.0f : 0.5f;
+    }
+    return resultWeight;
+}
+
 void BetterSongSearch::DataHolder::Search() {
     DEBUG("BetterSongSearch::DataHolder::Search called");
     // Skip if song details is null or if data is not loaded yet
@@ -271,12 +1187,16 @@ void BetterSongSearch::DataHolder::Search() {
     }
 
     this->searchInProgress = true;
+    long long searchStarted = CurrentTimeMs();
 
     // Detect changes
-    bool currentSortChanged = this->sort != this->currentSort;
-    bool currentSearchChanged = this->search != this->currentSearch;
+    bool currentSortChanged = std::exchange(this->starsChanged, false) || this->sort != this->currentSort;
+    // A different ranking only changes the order of search results
+    bool currentSearchChanged = this->search != this->currentSearch || (this->rankingMode != this->currentRankingMode && !this->search.empty());
     bool currentFilterChanged = !this->filterOptionsCache.IsEqual(this->filterOptions);
     bool currentForceReload = this->forceReload;
+    // Anything else only refreshes the same list, the table keeps its position then
+    bool queryChanged = currentSearchChanged || currentFilterChanged || this->sort != this->currentSort;
     DEBUG(
         "Current sort changed: {}, current search changed: {}, filter changed: {}, force reload: {}",
         currentSortChanged,
@@ -306,23 +1226,69 @@ void BetterSongSearch::DataHolder::Search() {
 
     // Grab current values for sort and search
     auto currentSort = this->sort;
-    // Current search (processed)
-    auto currentSearch = toLower(this->search);
+    // Current search (normalized and tokenized in the search thread)
+    auto currentSearch = this->search;
+
+    auto currentRankingMode = this->rankingMode;
 
     // Save
     this->currentSort = this->sort;
     this->currentSearch = this->search;
+    this->currentRankingMode = this->rankingMode;
 
-    std::thread([this, currentSearch, currentSort, currentFilterChanged, currentSortChanged, currentSearchChanged, currentForceReload] {
+    uint32_t searchId = ++this->_searchId;
+    // More results are only ranked for the list of the search that left them
+    this->_moreResults = false;
+    if (queryChanged) {
+        this->_queryChangedSearchId = searchId;
+    }
+
+    // Recent results are cached by everything they depend on, forced reloads mean something else changed.
+    // A new filter always filters again, the per difficulty results the cells show belong to the filter pass.
+    if (currentForceReload) {
+        InvalidateSearchCache();
+    }
+    SearchCacheKey cacheKey{currentSearch, this->filterOptionsCache.Fingerprint(), currentSort, currentRankingMode};
+    uint32_t cacheGeneration = 0;
+    std::vector<RankedSong> cachedSongs;
+    bool cacheHit = false;
+    {
+        std::lock_guard<std::mutex> lock(_searchCacheMutex);
+        cacheGeneration = this->_searchCacheGeneration;
+        auto cached = currentFilterChanged ? nullptr : this->_searchCache.Get(cacheKey);
+        if (cached != nullptr) {
+            cachedSongs = *cached;
+            cacheHit = true;
+        }
+    }
+    if (cacheHit) {
+        DEBUG("Search cache hit, {} songs", cachedSongs.size());
+        this->lastSearchDurationMs = CurrentTimeMs() - searchStarted;
+        PublishDisplayedSongs(std::move(cachedSongs), searchId, false, true);
+        return;
+    }
+
+    // A refresh keeps the table on the song the user looked at, which needs the final list to find it in
+    bool streamResults = queryChanged;
+
+    std::thread([this, searchId, searchStarted, cacheKey, cacheGeneration, currentSearch, currentSort, currentRankingMode, currentFilterChanged, currentSortChanged, currentSearchChanged, currentForceReload, streamResults] {
         long long before = CurrentTimeMs();
 
         // 4 threads are fine
         int const num_threads = 4;
         std::thread t[num_threads];
 
+        // Needed before filtering to know if the filtered songs can be streamed as they are
+        SearchQuery query(currentSearch, this->artists);
+
+        // Build the stars of the current leaderboard choice here so the workers and the cells only read them
+        this->BuildStarColumn();
+
         // Filter songs if needed
         if (currentFilterChanged || currentForceReload) {
             DEBUG("Filtering");
+            // Results of the last pass are for the old filter
+            this->filterGeneration++;
             int totalSongs = this->songDetails->songs.size();
             this->_filteredSongList.clear();
             if (this->filterOptionsCache.IsDefault()) {
@@ -331,53 +1297,127 @@ void BetterSongSearch::DataHolder::Search() {
                 for (auto& song : this->songDetails->songs) {
                     this->_filteredSongList.push_back(&song);
                 }
+                // Without a filter pass the labels get their own
+                this->OrderDiffLabels(this->_filteredSongList, currentSort);
             } else {
+                // The workers order the labels of the songs that pass
+                this->labelGeneration++;
+                this->_labelSortClass = LabelSortClass(currentSort);
+                // Narrow upload date, rating, votes or length ranges give the candidates with a binary search
+                long long candidatesBefore = CurrentTimeMs();
+                std::vector<uint32_t> candidates;
+                bool useCandidates = this->RangeCandidates(this->filterOptionsCache, candidates);
+                // Categorical filters are combined from the category bitmaps
+                RoaringBitmap categorySongs;
+                if (this->CategoryCandidates(this->filterOptionsCache, categorySongs)) {
+                    if (useCandidates) {
+                        categorySongs &= RoaringBitmap::FromSorted(candidates);
+                        candidates.clear();
+                    }
+                    categorySongs.ToVector(candidates);
+                    useCandidates = true;
+                }
+                if (useCandidates) {
+                    DEBUG("Indexes left {} of {} songs in {} ms", candidates.size(), totalSongs, CurrentTimeMs() - candidatesBefore);
+                    totalSongs = candidates.size();
+                }
+
                 // Set up variables for threads
+                long long scanBefore = CurrentTimeMs();
                 std::mutex valuesMutex;
                 std::atomic_int index = 0;
+                WorkerGroup workers;
+                workers.running = num_threads;
 
                 // Launch a group of threads
                 for (int i = 0; i < num_threads; ++i) {
-                    t[i] = std::thread([&index, &valuesMutex, totalSongs, this]() {
+                    t[i] = std::thread([&index, &valuesMutex, &workers, &candidates, useCandidates, totalSongs, currentSort, this]() {
                         int i = index++;
                         while (i < totalSongs) {
-                            SongDetailsCache::Song const& item = this->songDetails->songs.at(i);
+                            SongDetailsCache::Song const& item = this->songDetails->songs.at(useCandidates ? candidates[i] : i);
                             bool meetsFilter = MeetsFilter(&item);
                             if (meetsFilter) {
+                                auto result = GetDiffFilterResult(&item);
+                                SetDiffLabelOrder(item.index, OrderDifficultyLabels(&item, currentSort, result ? &*result : nullptr));
                                 std::lock_guard<std::mutex> lock(valuesMutex);
                                 _filteredSongList.push_back(&item);
                             }
                             i = index++;
                         }
+                        workers.Finish();
                     });
                 }
 
+                // Without a search the filtered songs only have to be sorted, so the ones found so far can be shown
+                while (!workers.WaitFor(SEARCH_STREAMING_INTERVAL_MS)) {
+                    if (!streamResults || !query.empty()) {
+                        continue;
+                    }
+                    auto sortFunction = sortFunctionMap.at(currentSort);
+                    std::vector<RankedSong> snapshot;
+                    {
+                        std::lock_guard<std::mutex> lock(valuesMutex);
+                        snapshot.reserve(this->_filteredSongList.size());
+                        for (auto item : this->_filteredSongList) {
+                            snapshot.push_back({item, sortFunction(item), 0});
+                        }
+                    }
+                    PublishDisplayedSongs(std::move(snapshot), searchId, true);
+                }
+
                 // Join the threads with the main thread
                 for (int i = 0; i < num_threads; ++i) {
                     t[i].join();
                 }
+                // Compare with the index time above, without candidates this is the full linear scan
+                DEBUG("MeetsFilter checked {} songs in {} ms", totalSongs, CurrentTimeMs() - scanBefore);
             }
         }
 
         INFO("Filtered in {} ms", CurrentTimeMs() - before);
 
+        // Switching to or from a star sort orders the labels differently, or the stars changed
+        if (LabelSortClass(currentSort) != this->_labelSortClass) {
+            this->OrderDiffLabels(this->_filteredSongList, currentSort);
+        }
+
+        // Filled if the relevance ranking stopped at the top results
+        RelevanceQuery relevanceQuery;
         if (currentFilterChanged || currentSearchChanged || currentSortChanged || currentForceReload) {
-            if (currentSearch.length() > 0) {
-                auto words = split(currentSearch, " ");
+            if (!query.empty()) {
+                auto const& words = query.tokens();
                 DEBUG("Words length {}", words.size());
-                for (int i = 0; i < words.size(); i++) {
-                    DEBUG("Search term: '{}'", words[i]);
+                for (auto const& word : words) {
+                    DEBUG("Search term: '{}' (key: {}, author: {})", word.text, word.maybeKey, word.isKnownAuthor);
                 };
 
-                // TODO: Process song key
+                // Key lookups go through the map id index instead of being compared for every song
+                // "1a2b3" matches the exact key (same as PC), "bsr 1a2b3" also matches keys starting with it
+                std::vector<uint32_t> keyMatches;
+                bool explicitKeySearch = false;
                 uint32_t possibleSongKey = 0;
-                // Try to parse song key if 1 word from 2 to 7 letters
-                if (words.size() == 1 && currentSearch.length() >= 2 && currentSearch.length() <= 7) {
-                    try {
-                        possibleSongKey = static_cast<uint32_t>(std::stoul(currentSearch, nullptr, 16));
-                    } catch (...) {
+                if (words.size() == 2 && words[0].text == "bsr" && words[1].maybeKey) {
+                    explicitKeySearch = true;
+                    possibleSongKey = words[1].keyValue;
+                    this->mapIdIndex.FindByKeyPrefix(words[1].text, keyMatches);
+                } else if (words.size() == 1 && words[0].maybeKey && words[0].text.length() >= 2 && words[0].text.length() <= 7) {
+                    possibleSongKey = words[0].keyValue;
+                    uint32_t songIndex = this->mapIdIndex.Find(possibleSongKey);
+                    if (songIndex != MapIdIndex::npos) {
+                        keyMatches.push_back(songIndex);
                     }
                 }
+                DEBUG("Key matches: {}", keyMatches.size());
+
+                bool relevanceRanking = currentRankingMode == FilterTypes::RankingMode::Relevance && !explicitKeySearch;
+
+                // The author part of the score only depends on the artist
+                long long artistsBefore = CurrentTimeMs();
+                std::vector<ArtistMatch> artistMatches;
+                if (!explicitKeySearch && !relevanceRanking) {
+                    artistMatches = MatchArtists(this->artists, query);
+                }
+                DEBUG("Matched {} artists in {} ms", artistMatches.size(), CurrentTimeMs() - artistsBefore);
 
                 float maxSearchWeight = 0.0f;
                 float maxSortWeight = 0.0f;
@@ -386,153 +1426,95 @@ void BetterSongSearch::DataHolder::Search() {
                 long long before = CurrentTimeMs();
                 this->_searchedSongList.clear();
                 // Set up variables for threads
-                int totalSongs = this->_filteredSongList.size();
+                // The relevance ranking doesn't scan the songs, it reads the top results from the token index
+                int totalSongs = explicitKeySearch || relevanceRanking ? 0 : this->_filteredSongList.size();
 
                 std::mutex valuesMutex;
                 std::atomic_int index = 0;
+                WorkerGroup workers;
+                workers.running = num_threads;
 
                 // Prefiltered songs
                 std::vector<xd> prefiltered;
 
+                // Classic weights are normalized so the sort can add up to half of the search weight
+                auto rankSearchResult = [](xd const& item, float maxSearchWeight, float maxSortWeight) -> RankedSong {
+                    float searchWeight = item.searchWeight / maxSearchWeight;
+                    searchWeight += std::min(searchWeight / 2, item.sortWeight / maxSortWeight * (searchWeight / 2));
+                    return {item.song, searchWeight, 0};
+                };
+
+                // Key matches are scored separately below, the text scorer skips them
+                std::vector<uint32_t> sortedKeyMatches = keyMatches;
+                std::sort(sortedKeyMatches.begin(), sortedKeyMatches.end());
+
+                if (relevanceRanking) {
+                    // Only songs that pass the filter can be returned, the index skips the others while merging
+                    std::vector<uint64_t> allowed;
+                    if (!this->filterOptionsCache.isDefaultPreprocessed) {
+                        allowed.assign((this->songDetails->songs.size() + 63) / 64, 0);
+                        for (auto songe : this->_filteredSongList) {
+                            allowed[songe->index / 64] |= 1ull << (songe->index % 64);
+                        }
+                    }
+
+                    std::vector<std::string_view> tokenTexts;
+                    tokenTexts.reserve(words.size());
+                    for (auto const& word : words) {
+                        tokenTexts.push_back(word.text);
+                    }
+
+                    auto isKeyMatch = [&sortedKeyMatches](uint32_t songIndex) {
+                        return !sortedKeyMatches.empty() && std::binary_search(sortedKeyMatches.begin(), sortedKeyMatches.end(), songIndex);
+                    };
+
+                    // Only the pruned top k is ranked, the songs that can't make it are skipped without being scored.
+                    // More are ranked when the list is scrolled to its end, see LoadMoreResults.
+                    // A word that is a prefix only expands to its maxPrefixExpansions most frequent terms, so even all pages are not every match.
+                    std::vector<TokenIndex::Result> results;
+                    this->tokenIndex.TopK(tokenTexts, RELEVANCE_FIRST_RESULTS, allowed.empty() ? nullptr : &allowed, results);
+                    if (results.size() == RELEVANCE_FIRST_RESULTS) {
+                        relevanceQuery.words.assign(tokenTexts.begin(), tokenTexts.end());
+                        relevanceQuery.allowed = std::move(allowed);
+                        relevanceQuery.resultCount = RELEVANCE_FIRST_RESULTS;
+                    }
+                    for (auto const& result : results) {
+                        if (isKeyMatch(result.songIndex)) {
+                            continue;
+                        }
+                        auto songe = &this->songDetails->songs.at(result.songIndex);
+                        float sortWeight = sortFunctionMap.at(currentSort)(songe);
+                        prefiltered.push_back({songe, result.score, sortWeight});
+                        maxSearchWeight = std::max(maxSearchWeight, result.score);
+                        maxSortWeight = std::max(maxSortWeight, sortWeight);
+                    }
+                }
+
                 // Launch a group of threads
                 for (int i = 0; i < num_threads; ++i) {
                     t[i] = std::thread(
                         [this,
                          &index,
                          &valuesMutex,
+                         &workers,
                          totalSongs,
-                         currentSearch,
-                         words,
+                         &query,
+                         &artistMatches,
                          &prefiltered,
                          &maxSearchWeight,
                          &maxSortWeight,
-                         currentSort,
-                         possibleSongKey](std::vector<std::string> searchQuery) {
+                         &sortedKeyMatches,
+                         currentSort]() {
                             int j = index++;
                             while (j < totalSongs) {
                                 auto songe = this->_filteredSongList[j];
+                                j = index++;
 
-                                float resultWeight = 0;
-                                bool matchedAuthor = false;
-                                int prevMatchIndex = -1;
-
-                                std::string songName = removeSpecialCharacter(toLower(songe->songName()));
-                                std::string songAuthorName = removeSpecialCharacter(toLower(songe->songAuthorName()));
-                                std::string levelAuthorName = removeSpecialCharacter(toLower(songe->levelAuthorName()));
-                                uint32_t songKey = songe->mapId();
-
-                                // If song key is present and mapid == songkey, pull it to the top
-                                if (possibleSongKey != 0 && songKey == possibleSongKey) {
-                                    resultWeight = 30;
-                                }
-
-                                // Find full match author name
-                                int authorFullMatch = currentSearch.find(songAuthorName);
-
-                                // set up i for the loop
-                                int i = 0;
-
-                                if (songAuthorName.length() > 4 && authorFullMatch != std::string::npos &&
-                                    // Checks if there is a space after the supposedly matched author name
-                                    (currentSearch.length() == songAuthorName.length() || IsSpace(currentSearch[songAuthorName.length()]))) {
-                                    matchedAuthor = true;
-                                    resultWeight += songAuthorName.length() > 5 ? 25 : 20;
-
-                                    // If the author is matched and is the first, then skip first word (i + 1)
-                                    // This is super cheapskate - I'd have to replace the author from the filter and recreate the words array otherwise
-                                    if (authorFullMatch == 0) {
-                                        i = 1;
-                                    }
-                                }
-
-                                // Go over a list of words
-                                for (; i < words.size(); i++) {
-                                    // If the word matches the author 1:1 thats cool innit
-                                    // If author name is not empty
-                                    if (songAuthorName.length() != 0) {
-                                        // If not matched author and author name == word then add weight, skip if author is already matched
-                                        if (!matchedAuthor && songAuthorName == words[i]) {
-                                            matchedAuthor = true;
-                                            // 3*length of the word divided by 2? wtf
-                                            resultWeight += 3.0f * ((float) words[i].length() / 2.0f);
-
-                                            // Go to next word
-                                            continue;
-                                            // Otherwise we'll have to check if its contained within this word
-                                        } else if (!matchedAuthor && words[i].length() >= 3) {
-                                            int index = songAuthorName.find(words[i]);
-
-                                            // If found in the beginning or is space at the end of author name which means we matched the beginning of
-                                            // a word
-                                            if (index == 0 || (index > 0 && IsSpace(songAuthorName[index - 1]))) {
-                                                matchedAuthor = true;
-                                                // Add weight
-                                                resultWeight +=
-                                                    (int) round((index == 0 ? 4.0f : 3.0f) * ((float) words[i].length() / songAuthorName.length()));
-                                                continue;
-                                            }
-                                        }
-                                    }
-
-                                    int matchpos = songName.find(words[i]);
-                                    if (matchpos != std::string::npos) {
-                                        // Check if we matched the beginning of a word
-                                        bool wordStart = matchpos == 0 || songName[matchpos - 1] == ' ';
-
-                                        // If it was the beginning add 5 weighting, else 3
-                                        resultWeight += wordStart ? 5 : 3;
-
-                                        ///////////////// New algo  /////////////////////////
-                                        // Find the position in the name
-                                        int posInName = matchpos + words[i].length();
-
-                                        /*
-                                         * Check if we are at the end of the song name, but only if it has at least 8 characters
-                                         * We do this because otherwise, when searching for "lowermost revolt", songs where the
-                                         * songName is exactly "lowermost revolt" would have a lower result weight than
-                                         * "lowermost revolt (JoeBama cover)"
-                                         *
-                                         * The 8 character limitation for this is so that super short words like "those" dont end
-                                         * up triggering this
-                                         */
-                                        if (songName.length() >= 6 && songName.length() == posInName) {
-                                            resultWeight += 3;
-                                        } else {
-                                            // If we did match the beginning, check if we matched an entire word. Get the end index as indicated by
-                                            // our needle
-                                            bool maybeWordEnd = wordStart && posInName < songName.length();
-
-                                            // Check if we actually end up at a non word char, if so add 2 weighting
-                                            if (maybeWordEnd && songName[matchpos + words[i].length()] == ' ') {
-                                                resultWeight += 2;
-                                            }
-                                        }
-                                        /////////////////////////////////////////////////////
-
-                                        //// Old algo for testing pc compatibility (comment out new algo and uncomment this for comparison with PC)
-                                        /////////////
-                                        // bool maybeWordEnd = wordStart && matchpos + words[i].length() < songName.length();
-
-                                        // // Check if we actually end up at a non word char, if so add 2 weighting
-                                        // if(maybeWordEnd && songName[matchpos + words[i].length()] == ' ')
-                                        //     resultWeight += 2;
-                                        ////////////////////////////////////////////////////
-
-                                        // If the word we just checked is behind the previous matched, add another 1 weight
-                                        if (prevMatchIndex != -1 && matchpos > prevMatchIndex) {
-                                            resultWeight += 1;
-                                        }
-
-                                        prevMatchIndex = matchpos;
-                                    }
+                                if (!sortedKeyMatches.empty() && std::binary_search(sortedKeyMatches.begin(), sortedKeyMatches.end(), songe->index)) {
+                                    continue;
                                 }
 
-                                for (i = 0; i < words.size(); i++) {
-                                    if (words[i].length() > 3 && levelAuthorName.find(words[i]) != std::string::npos) {
-                                        resultWeight += 1;
-                                        break;
-                                    }
-                                }
+                                float resultWeight = CalculateSearchWeight(songe, query, artistMatches[this->artists.ArtistOf(songe->index)]);
 
                                 if (resultWeight > 0) {
                                     float sortWeight = sortFunctionMap.at(currentSort)(songe);
@@ -541,10 +1523,6 @@ void BetterSongSearch::DataHolder::Search() {
 
                                     prefiltered.push_back({songe, resultWeight, sortWeight});
 
-                                    // #if DEBUG
-                                    //                         x.sortWeight = sortWeight;
-                                    //                         x.resultWeight = resultWeight;
-                                    // #endif
                                     if (maxSearchWeight < resultWeight) {
                                         maxSearchWeight = resultWeight;
                                     }
@@ -553,98 +1531,480 @@ void BetterSongSearch::DataHolder::Search() {
                                         maxSortWeight = sortWeight;
                                     }
                                 }
-                                j = index++;
                             }
-                        },
-                        words
+                            workers.Finish();
+                        }
                     );
                 }
 
+                // Show the best matches found so far, the weights are normalized with the maximums so far
+                while (!workers.WaitFor(SEARCH_STREAMING_INTERVAL_MS)) {
+                    if (!streamResults) {
+                        continue;
+                    }
+                    std::vector<RankedSong> snapshot;
+                    {
+                        std::lock_guard<std::mutex> lock(valuesMutex);
+                        snapshot.reserve(prefiltered.size());
+                        for (auto const& item : prefiltered) {
+                            snapshot.push_back(rankSearchResult(item, maxSearchWeight, maxSortWeight));
+                        }
+                    }
+                    PublishDisplayedSongs(std::move(snapshot), searchId, true);
+                }
+
                 // Join the threads with the main thread
                 for (int i = 0; i < num_threads; ++i) {
                     t[i].join();
                 }
 
+                // Merge key matches, they still have to pass the current filter
+                float textMaxWeight = maxSearchWeight;
+                for (auto songIndex : keyMatches) {
+                    auto songe = &this->songDetails->songs.at(songIndex);
+                    if (!this->filterOptionsCache.isDefaultPreprocessed && !MeetsFilter(songe)) {
+                        continue;
+                    }
+
+                    // If song key is present and mapid == songkey, pull it to the top
+                    float resultWeight = songe->mapId() == possibleSongKey ? 30 : 10;
+                    if (relevanceRanking) {
+                        // Relevance scores have no fixed range, keep keys above every text match
+                        resultWeight = textMaxWeight + resultWeight / 10;
+                    } else if (!explicitKeySearch) {
+                        resultWeight += CalculateSearchWeight(songe, query, artistMatches[this->artists.ArtistOf(songe->index)]);
+                    }
+                    float sortWeight = sortFunctionMap.at(currentSort)(songe);
+
+                    prefiltered.push_back({songe, resultWeight, sortWeight});
+                    maxSearchWeight = std::max(maxSearchWeight, resultWeight);
+                    maxSortWeight = std::max(maxSortWeight, sortWeight);
+                    if (relevanceQuery.resultCount > 0) {
+                        relevanceQuery.keyMatches.push_back({songe, resultWeight, sortWeight});
+                    }
+                }
+
                 INFO("Calculated search indexes in {} ms", CurrentTimeMs() - before);
-                if (prefiltered.size() == 0) {
-                    this->_searchedSongList.clear();
-                } else {
-                    long long before = CurrentTimeMs();
-                    float maxSearchWeightInverse = 1.0f / maxSearchWeight;
-                    float maxSortWeightInverse = 1.0f / maxSortWeight;
 
-                    // Calculate total search weight
-                    for (auto& item : prefiltered) {
-                        float searchWeight = item.searchWeight * maxSearchWeightInverse;
-                        item.searchWeight = searchWeight + std::min(searchWeight / 2, item.sortWeight * maxSortWeightInverse * (searchWeight / 2));
+                // Not much found, try again with typos allowed
+                if (!explicitKeySearch && prefiltered.size() < FUZZY_SEARCH_MIN_RESULTS) {
+                    long long fuzzyBefore = CurrentTimeMs();
+
+                    std::vector<FuzzyWord> fuzzyWords;
+                    bool canMatchFuzzy = false;
+                    for (auto const& word : words) {
+                        FuzzyWord fuzzyWord{word.text, {}, FuzzyMaxDistance(word.text.length())};
+                        if (!fuzzyWord.pattern.Set(word.text)) {
+                            fuzzyWord.maxDistance = 0;
+                        }
+                        canMatchFuzzy |= fuzzyWord.maxDistance > 0;
+                        fuzzyWords.push_back(std::move(fuzzyWord));
                     }
 
-                    std::stable_sort(prefiltered.begin(), prefiltered.end(), [](xd const& s1, xd const& s2) {
-                        return s1.searchWeight > s2.searchWeight;
-                    });
+                    if (canMatchFuzzy) {
+                        // Songs that already matched exactly keep their exact weight
+                        std::vector<uint32_t> exactMatches;
+                        exactMatches.reserve(prefiltered.size());
+                        for (auto const& item : prefiltered) {
+                            exactMatches.push_back(item.song->index);
+                        }
+                        std::sort(exactMatches.begin(), exactMatches.end());
+
+                        // Fuzzy weights are at most 2 per word, relevance scores are scaled below the worst exact match
+                        float fuzzyScale = 1.0f;
+                        if (relevanceRanking && !prefiltered.empty()) {
+                            float minExactWeight = prefiltered.front().searchWeight;
+                            for (auto const& item : prefiltered) {
+                                minExactWeight = std::min(minExactWeight, item.searchWeight);
+                            }
+                            fuzzyScale = minExactWeight / (2 * words.size() + 1);
+                        }
+
+                        // Every filtered song is checked, so the same query always finds the same songs however busy the device is
+                        std::atomic_int fuzzyIndex = 0;
+                        int fuzzyTotalSongs = this->_filteredSongList.size();
+
+                        for (int i = 0; i < num_threads; ++i) {
+                            t[i] = std::thread([this,
+                                                &fuzzyIndex,
+                                                &valuesMutex,
+                                                fuzzyTotalSongs,
+                                                &fuzzyWords,
+                                                &exactMatches,
+                                                fuzzyScale,
+                                                &prefiltered,
+                                                &maxSearchWeight,
+                                                &maxSortWeight,
+                                                currentSort]() {
+                                int j = fuzzyIndex++;
+                                while (j < fuzzyTotalSongs) {
+                                    auto songe = this->_filteredSongList[j];
+                                    j = fuzzyIndex++;
+
+                                    if (std::binary_search(exactMatches.begin(), exactMatches.end(), songe->index)) {
+                                        continue;
+                                    }
+
+                                    float resultWeight = CalculateFuzzySearchWeight(songe, fuzzyWords) * fuzzyScale;
+                                    if (resultWeight > 0) {
+                                        float sortWeight = sortFunctionMap.at(currentSort)(songe);
+
+                                        std::lock_guard<std::mutex> lock(valuesMutex);
+                                        prefiltered.push_back({songe, resultWeight, sortWeight});
+                                        maxSearchWeight = std::max(maxSearchWeight, resultWeight);
+                                        maxSortWeight = std::max(maxSortWeight, sortWeight);
+                                    }
+                                }
+                            });
+                        }
+
+                        for (int i = 0; i < num_threads; ++i) {
+                            t[i].join();
+                        }
 
+                        INFO("Fuzzy search of {} songs in {} ms, {} results total", fuzzyTotalSongs, CurrentTimeMs() - fuzzyBefore, prefiltered.size());
+                    }
+                }
+                if (prefiltered.size() == 0) {
+                    this->_searchedSongList.clear();
+                } else {
                     this->_searchedSongList.reserve(prefiltered.size());
-                    for (auto& x : prefiltered) {
-                        this->_searchedSongList.push_back(x.song);
+                    for (auto& item : prefiltered) {
+                        if (relevanceRanking) {
+                            // The relevance score decides, the sort only breaks ties
+                            this->_searchedSongList.push_back({item.song, item.searchWeight, item.sortWeight});
+                        } else {
+                            this->_searchedSongList.push_back(rankSearchResult(item, maxSearchWeight, maxSortWeight));
+                        }
                     }
-                    INFO("sorted search results in {} ms", CurrentTimeMs() - before);
                 }
             } else {
-                long long before = CurrentTimeMs();
-
-                std::vector<xd> prefiltered;
                 auto sortFunction = sortFunctionMap.at(currentSort);
-                for (auto item : _filteredSongList) {
-                    auto score = sortFunction(item);
-                    prefiltered.push_back({item, 0, score});
-                }
-
-                std::stable_sort(prefiltered.begin(), prefiltered.end(), [](xd const& s1, xd const& s2) {
-                    return s1.sortWeight > s2.sortWeight;
-                });
-
                 this->_searchedSongList.clear();
                 this->_searchedSongList.reserve(this->_filteredSongList.size());
-
-                // Push to searched
-                for (auto& x : prefiltered) {
-                    this->_searchedSongList.push_back(x.song);
+                for (auto item : _filteredSongList) {
+                    this->_searchedSongList.push_back({item, sortFunction(item), 0});
                 }
-
-                INFO("Sort without search in {} ms", CurrentTimeMs() - before);
             }
         }
 
         DEBUG("Search time: {}ms", CurrentTimeMs() - before);
         DEBUG("Found {} songs", _searchedSongList.size());
 
-        // Copy the list to the displayed one
-        DEBUG("Clearing displayedSongList");
-        std::unique_lock<std::shared_mutex> lock(_displayedSongListMutex);
-        this->_displayedSongList.clear();
-        this->_displayedSongList = this->_searchedSongList;
-        lock.unlock();
+        this->lastSearchDurationMs = CurrentTimeMs() - searchStarted;
+        bool moreResults = relevanceQuery.resultCount > 0;
+        {
+            std::lock_guard<std::mutex> lock(_relevanceQueryMutex);
+            relevanceQuery.searchId = searchId;
+            relevanceQuery.sort = currentSort;
+            relevanceQuery.cacheKey = cacheKey;
+            relevanceQuery.cacheGeneration = cacheGeneration;
+            this->_relevanceQuery = std::move(relevanceQuery);
+            this->_moreResults = moreResults;
+        }
+        uint32_t generation = PublishDisplayedSongs(std::move(this->_searchedSongList), searchId, false);
+        this->_searchedSongList.clear();
+        // A list with more results to rank is cached once it has them all
+        if (!moreResults) {
+            CacheDisplayedSongs(cacheKey, generation, cacheGeneration);
+        }
+    }).detach();
+}
 
-        this->searchInProgress = false;
+void BetterSongSearch::DataHolder::LoadMoreResults() {
+    if (!this->_moreResults || this->searchInProgress || this->_loadingMoreResults.exchange(true)) {
+        return;
+    }
 
-        // Replace the list with the searched one in the main thread to prevent unsafe stuff
-        BSML::MainThreadScheduler::Schedule([this] {
-            this->searchEnded.invoke();
-        });
+    std::thread([this] {
+        RelevanceQuery query;
+        {
+            std::lock_guard<std::mutex> lock(_relevanceQueryMutex);
+            query = this->_relevanceQuery;
+        }
+        long long before = CurrentTimeMs();
+        std::size_t k = query.resultCount * RELEVANCE_RESULTS_GROWTH;
+        std::vector<std::string_view> words(query.words.begin(), query.words.end());
+        std::vector<TokenIndex::Result> results;
+        this->tokenIndex.TopK(words, k, query.allowed.empty() ? nullptr : &query.allowed, results);
+
+        // Key matches are ranked above every text match, like in the search
+        std::vector<uint32_t> keyMatches;
+        std::vector<RankedSong> songs = query.keyMatches;
+        for (auto const& item : query.keyMatches) {
+            keyMatches.push_back(item.song->index);
+        }
+        std::sort(keyMatches.begin(), keyMatches.end());
+        auto sortFunction = sortFunctionMap.at(query.sort);
+        for (auto const& result : results) {
+            if (std::binary_search(keyMatches.begin(), keyMatches.end(), result.songIndex)) {
+                continue;
+            }
+            auto songe = &this->songDetails->songs.at(result.songIndex);
+            songs.push_back({songe, result.score, sortFunction(songe)});
+        }
+        bool moreResults = results.size() == k;
+        DEBUG("Ranked {} more relevance results in {} ms", songs.size(), CurrentTimeMs() - before);
+
+        {
+            std::lock_guard<std::mutex> lock(_relevanceQueryMutex);
+            // Another search replaced the list while ranking
+            if (this->_relevanceQuery.searchId != query.searchId || this->_searchId != query.searchId) {
+                this->_loadingMoreResults = false;
+                return;
+            }
+            this->_relevanceQuery.resultCount = k;
+            this->_moreResults = moreResults;
+        }
+        uint32_t generation = PublishDisplayedSongs(std::move(songs), query.searchId, false);
+        if (!moreResults) {
+            CacheDisplayedSongs(query.cacheKey, generation, query.cacheGeneration);
+        }
+        this->_loadingMoreResults = false;
     }).detach();
 }
 
-std::vector<SongDetailsCache::Song const*> BetterSongSearch::DataHolder::GetDisplayedSongList() {
+uint32_t BetterSongSearch::DataHolder::PublishDisplayedSongs(std::vector<RankedSong> songs, uint32_t searchId, bool partial, bool sorted) {
+    // Only the first page is ordered before publishing, it's all the table shows at first
+    long long before = CurrentTimeMs();
+    std::size_t firstPage = sorted ? songs.size() : std::min(SEARCH_FIRST_PAGE_SIZE, songs.size());
+    if (!sorted) {
+        std::partial_sort(songs.begin(), songs.begin() + firstPage, songs.end(), RankedBefore<RankedSong>);
+    }
+    std::vector<RankedSong> tail;
+    if (!partial) {
+        tail.assign(songs.begin() + firstPage, songs.end());
+    }
+    DEBUG("Ranked the first {} of {} results in {} ms (partial: {})", firstPage, songs.size(), CurrentTimeMs() - before, partial);
+
+    std::unique_lock<std::shared_mutex> lock(_displayedSongListMutex);
+    // More results of an older search (see LoadMoreResults) after a newer one was shown
+    if (searchId < this->_displayedSearchId) {
+        return 0;
+    }
+    if (searchId != this->_displayedSearchId) {
+        // Only the ordered part can have been shown
+        std::size_t shown = std::min(this->_displayedSortedCount, DISPLAYED_DIFF_MAX_SIZE);
+        this->_previousDisplayedSongs.clear();
+        for (std::size_t i = 0; i < shown; i++) {
+            this->_previousDisplayedSongs.push_back(this->_displayedSongList[i].song);
+        }
+    }
+    this->_displayedSongList = std::move(songs);
+    this->_displayedSortedCount = firstPage;
+    this->_displayedSearchId = searchId;
+    this->_displayedPartial = partial;
+    uint32_t generation = ++this->_displayedGeneration;
+    lock.unlock();
+
+    if (!partial && searchId == this->_searchId) {
+        this->searchInProgress = false;
+    }
+
+    // Replace the list with the searched one in the main thread to prevent unsafe stuff
+    BSML::MainThreadScheduler::Schedule([this] {
+        this->searchEnded.invoke();
+    });
+
+    // Sort the rest while the first page is shown, the result is the same as sorting on demand.
+    // Partial lists are replaced soon anyway, scrolling sorts them on demand.
+    if (!tail.empty()) {
+        long long tailBefore = CurrentTimeMs();
+        std::sort(tail.begin(), tail.end(), RankedBefore<RankedSong>);
+
+        std::unique_lock<std::shared_mutex> tailLock(_displayedSongListMutex);
+        if (generation == this->_displayedGeneration) {
+            std::copy(tail.begin(), tail.end(), this->_displayedSongList.begin() + firstPage);
+            this->_displayedSortedCount = this->_displayedSongList.size();
+            DEBUG("Sorted the remaining {} results in {} ms", tail.size(), CurrentTimeMs() - tailBefore);
+        }
+    }
+    return generation;
+}
+
+void BetterSongSearch::DataHolder::CacheDisplayedSongs(SearchCacheKey key, uint32_t generation, uint32_t cacheGeneration) {
+    std::vector<RankedSong> songs;
+    {
+        std::shared_lock<std::shared_mutex> lock(_displayedSongListMutex);
+        // Replaced by a newer search or not sorted
+        if (generation != this->_displayedGeneration || this->_displayedSortedCount != this->_displayedSongList.size()) {
+            return;
+        }
+        songs = this->_displayedSongList;
+    }
+
+    std::size_t bytes = sizeof(SearchCacheKey) + key.search.size() + songs.size() * sizeof(RankedSong);
+    std::lock_guard<std::mutex> lock(_searchCacheMutex);
+    if (cacheGeneration != this->_searchCacheGeneration) {
+        return;
+    }
+    this->_searchCache.Put(std::move(key), std::move(songs), bytes);
+    DEBUG("Search cache: {} entries, {} KB", this->_searchCache.size(), this->_searchCache.bytes() / 1024);
+}
+
+std::size_t BetterSongSearch::DataHolder::StarColumnIndex() const {
+    auto rankedFilter = static_cast<FilterTypes::RankedFilter>(this->filterOptionsCache.rankedType);
+
+    // Only these ranked filters change which leaderboard is used
+    std::size_t rankedClass = 2;
+    if (rankedFilter == FilterTypes::RankedFilter::BeatLeaderRanked) {
+        rankedClass = 0;
+    } else if (rankedFilter == FilterTypes::RankedFilter::ScoreSaberRanked) {
+        rankedClass = 1;
+    }
+    return static_cast<std::size_t>(this->preferredLeaderboard) * 3 + rankedClass;
+}
+
+std::shared_ptr<BetterSongSearch::StarColumn const> BetterSongSearch::DataHolder::GetStarColumn() const {
+    std::size_t columnIndex = StarColumnIndex();
+    if (columnIndex >= STAR_COLUMN_COUNT) {
+        return nullptr;
+    }
+    return std::atomic_load(&starColumns[columnIndex]);
+}
+
+void BetterSongSearch::DataHolder::BuildStarColumn() {
+    auto rankedFilter = static_cast<FilterTypes::RankedFilter>(this->filterOptionsCache.rankedType);
+    auto preferred = this->preferredLeaderboard;
+    std::size_t columnIndex = StarColumnIndex();
+    if (columnIndex >= STAR_COLUMN_COUNT || std::atomic_load(&starColumns[columnIndex]) != nullptr) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(starColumnsMutex);
+    if (!this->songDetails || !starDiffBase || starDiffBase->size() != this->songDetails->songs.size() + 1) {
+        return;
+    }
+
+    long long before = CurrentTimeMs();
+    auto column = std::make_shared<StarColumn>();
+    column->diffBase = starDiffBase;
+    column->stars.resize(starDiffBase->back());
+    uint32_t diffIndex = 0;
+    for (auto const& song : this->songDetails->songs) {
+        auto state = TargetedRankLeaderboardService(song.rankedStates, rankedFilter, preferred);
+        for (auto const& diff : song) {
+            column->stars[diffIndex++] = getStars(&diff, state);
+        }
+    }
+    std::atomic_store(&starColumns[columnIndex], std::shared_ptr<StarColumn const>(std::move(column)));
+    DEBUG("Built star column {} in {} ms", columnIndex, CurrentTimeMs() - before);
+}
+
+void BetterSongSearch::DataHolder::SetPreferredLeaderboard(FilterTypes::PreferredLeaderBoard leaderboard) {
+    if (this->preferredLeaderboard == leaderboard) {
+        return;
+    }
+    this->preferredLeaderboard = leaderboard;
+
+    // Cached results, difficulty filter results and label orders have the stars of the old leaderboard
+    InvalidateSearchCache();
+    this->filterGeneration++;
+    this->labelGeneration++;
+    this->_labelSortClass = -1;
+
+    // Stars only decide which songs are shown if there is a star filter, otherwise only star sorts need to run again
+    if (this->filterOptions.minStars > 0 || this->filterOptions.maxStars != STAR_FILTER_MAX) {
+        this->forceReload = true;
+    } else if (this->sort == FilterTypes::SortMode::Most_Stars || this->sort == FilterTypes::SortMode::Least_Stars) {
+        this->starsChanged = true;
+    }
+}
+
+void BetterSongSearch::DataHolder::InvalidateSearchCache() {
+    std::lock_guard<std::mutex> lock(_searchCacheMutex);
+    this->_searchCache.Clear();
+    this->_searchCacheGeneration++;
+}
+
+bool BetterSongSearch::DataHolder::IsDisplayedSongListPartial() {
     std::shared_lock<std::shared_mutex> lock(_displayedSongListMutex);
-    return this->_displayedSongList;
+    return this->_displayedPartial;
 }
 
-SongDetailsCache::Song const* BetterSongSearch::DataHolder::GetDisplayedSongByIndex(std::size_t index) {
+uint32_t BetterSongSearch::DataHolder::GetDisplayedSearchId() {
+    std::shared_lock<std::shared_mutex> lock(_displayedSongListMutex);
+    return this->_displayedSearchId;
+}
+
+bool BetterSongSearch::DataHolder::IsDisplayedSongListRefresh() {
     std::shared_lock<std::shared_mutex> lock(_displayedSongListMutex);
+    return this->_displayedSearchId != this->_queryChangedSearchId;
+}
+
+std::size_t BetterSongSearch::DataHolder::GetFirstChangedDisplayedIndex(std::size_t limit) {
+    std::unique_lock<std::shared_mutex> lock(_displayedSongListMutex);
+    limit = std::min(limit, std::max(this->_displayedSongList.size(), this->_previousDisplayedSongs.size()));
+    SortDisplayedSongs(std::min(limit, this->_displayedSongList.size()));
+    for (std::size_t i = 0; i < limit; i++) {
+        if (i >= this->_displayedSongList.size() || i >= this->_previousDisplayedSongs.size() ||
+            this->_displayedSongList[i].song != this->_previousDisplayedSongs[i]) {
+            return i;
+        }
+    }
+    return limit;
+}
+
+std::size_t BetterSongSearch::DataHolder::MapPreviousDisplayedIndex(std::size_t previousIndex, std::size_t limit) {
+    std::unique_lock<std::shared_mutex> lock(_displayedSongListMutex);
+    if (previousIndex >= this->_previousDisplayedSongs.size()) {
+        return SIZE_MAX;
+    }
+    auto song = this->_previousDisplayedSongs[previousIndex];
+    limit = std::min(limit, this->_displayedSongList.size());
+    SortDisplayedSongs(limit);
+    for (std::size_t i = 0; i < limit; i++) {
+        if (this->_displayedSongList[i].song == song) {
+            return i;
+        }
+    }
+    return SIZE_MAX;
+}
+
+void BetterSongSearch::DataHolder::SortDisplayedSongs(std::size_t count) {
+    if (count <= this->_displayedSortedCount) {
+        return;
+    }
+    // Sort a page ahead so scrolling doesn't sort again for every row
+    auto sortedEnd = std::min(this->_displayedSongList.size(), count + SEARCH_FIRST_PAGE_SIZE);
+    std::partial_sort(
+        this->_displayedSongList.begin() + this->_displayedSortedCount,
+        this->_displayedSongList.begin() + sortedEnd,
+        this->_displayedSongList.end(),
+        RankedBefore<RankedSong>
+    );
+    this->_displayedSortedCount = sortedEnd;
+}
+
+std::vector<SongDetailsCache::Song const*> BetterSongSearch::DataHolder::GetDisplayedSongList() {
+    std::unique_lock<std::shared_mutex> lock(_displayedSongListMutex);
+    SortDisplayedSongs(this->_displayedSongList.size());
+    std::vector<SongDetailsCache::Song const*> songs;
+    songs.reserve(this->_displayedSongList.size());
+    for (auto const& ranked : this->_displayedSongList) {
+        songs.push_back(ranked.song);
+    }
+    return songs;
+}
+
+SongDetailsCache::Song const* BetterSongSearch::DataHolder::GetDisplayedSongByIndex(std::size_t index) {
+    {
+        std::shared_lock<std::shared_mutex> lock(_displayedSongListMutex);
+        if (index >= this->_displayedSongList.size()) {
+            return nullptr;
+        }
+        if (index < this->_displayedSortedCount) {
+            return this->_displayedSongList[index].song;
+        }
+    }
+
+    // Scrolled past the ordered part before the background sort finished
+    std::unique_lock<std::shared_mutex> lock(_displayedSongListMutex);
     if (index >= this->_displayedSongList.size()) {
         return nullptr;
     }
-    return this->_displayedSongList[index];
+    SortDisplayedSongs(index + 1);
+    return this->_displayedSongList[index].song;
 }
 
 std::size_t BetterSongSearch::DataHolder::GetDisplayedSongListLength() {
@@ -1,5 +1,7 @@
 #include "FilterOptions.hpp"
 
+#include <limits>
+
 #include "DataHolder.hpp"
 #include "logging.hpp"
 #include "main.hpp"
@@ -267,6 +269,12 @@ void BetterSongSearch::FilterProfile::RecalculatePreprocessedValues() {
 
     isDefaultPreprocessed = IsDefault();
 
+    starsBoundsPreprocessed = Util::QuantizedColumns::MakeBounds(
+        Util::QuantizedColumns::STARS_SCALE, minStars > 0 ? minStars : -1.0f, maxStars != STAR_FILTER_MAX ? maxStars : std::numeric_limits<float>::max()
+    );
+    njsBoundsPreprocessed = Util::QuantizedColumns::MakeBounds(Util::QuantizedColumns::NJS_SCALE, minNJS, maxNJS);
+    npsBoundsPreprocessed = Util::QuantizedColumns::MakeBounds(Util::QuantizedColumns::NPS_SCALE, minNPS, maxNPS);
+
     // Calculate bit fields
     _mapStyleBitfield = CalculateTagsBitfield(mapStyleString);
     _mapGenreBitfield = CalculateTagsBitfield(mapGenreString);
@@ -344,6 +352,42 @@ bool BetterSongSearch::FilterProfile::IsEqual(BetterSongSearch::FilterProfile co
     // clang-format on
 }
 
+uint64_t BetterSongSearch::FilterProfile::Fingerprint() const {
+    // FNV-1a over the raw bytes of every value
+    uint64_t hash = 14695981039346656037ull;
+    auto add = [&hash](void const* data, std::size_t size) {
+        auto bytes = static_cast<uint8_t const*>(data);
+        for (std::size_t i = 0; i < size; i++) {
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+        }
+    };
+    auto addValue = [&add](auto const& value) {
+        add(&value, sizeof(value));
+    };
+    auto addString = [&add, &addValue](std::string const& value) {
+        addValue(value.size());
+        add(value.data(), value.size());
+    };
+
+    for (auto value : {downloadType, localScoreType, rankedType, minUploadDate, minVotes, charFilter, difficultyFilter, modRequirement, minUploadDateInMonths}) {
+        addValue(value);
+    }
+    for (auto value : {minLength, maxLength, minNJS, maxNJS, minNPS, maxNPS, minStars, maxStars, minRating}) {
+        addValue(value);
+    }
+    for (bool value : {onlyCuratedMaps, onlyVerifiedMappers, onlyV3Maps, uploadersBlackList}) {
+        addValue(value);
+    }
+    addValue(uploaders.size());
+    for (auto const& uploader : uploaders) {
+        addString(uploader);
+    }
+    addString(mapStyleString);
+    addString(mapGenreString);
+    addString(mapGenreExcludeString);
+    return hash;
+}
+
 void BetterSongSearch::FilterProfile::PrintToDebug() {
     DEBUG("FilterProfile: ");
     DEBUG("DownloadType: {}", downloadType);
@@ -97,7 +97,7 @@ void BetterSongSearch::UI::FlowCoordinators::BetterSongSearchFlowCoordinator::Co
                     DownloadHistoryEntry::DownloadStatus::Downloading | DownloadHistoryEntry::DownloadStatus::Queued
                 ))) {
                 entry->retries = 69;
-                entry->status = DownloadHistoryEntry::DownloadStatus::Failed;
+                entry->SetStatus(DownloadHistoryEntry::DownloadStatus::Failed);
             }
         }
 
@@ -73,10 +73,33 @@ StringW Modals::Settings::get_preferredLeaderboard() {
 
 void Modals::Settings::set_preferredLeaderboard(StringW value) {
     if (LEADERBOARD_MAP.contains(value)) {
-        dataHolder.preferredLeaderboard = LEADERBOARD_MAP.at(value);
+        // Only filters or sorts again if stars matter for the current list
+        dataHolder.SetPreferredLeaderboard(LEADERBOARD_MAP.at(value));
         getPluginConfig().PreferredLeaderboard.SetValue(value);
         auto controller = fcInstance->SongListController;
-        dataHolder.forceReload = true;
+        controller->SortAndFilterSongs(dataHolder.sort, dataHolder.search, true);
+        // Cells show the stars of the preferred leaderboard
+        controller->songListTable()->ReloadData();
+    }
+}
+
+StringW Modals::Settings::get_rankingMode() {
+    std::string rankingMode = getPluginConfig().RankingMode.GetValue();
+    if (RANKING_MODE_MAP.contains(rankingMode)) {
+        return rankingMode;
+    } else {
+        dataHolder.rankingMode = FilterTypes::RankingMode::Classic;
+        getPluginConfig().RankingMode.SetValue("Classic");
+        return "Classic";
+    }
+}
+
+void Modals::Settings::set_rankingMode(StringW value) {
+    if (RANKING_MODE_MAP.contains(value)) {
+        dataHolder.rankingMode = RANKING_MODE_MAP.at(value);
+        getPluginConfig().RankingMode.SetValue(value);
+        // Only the order of the search results changes, the filter is kept
+        auto controller = fcInstance->SongListController;
         controller->SortAndFilterSongs(dataHolder.sort, dataHolder.search, true);
     }
 }
@@ -25,7 +25,7 @@ DEFINE_TYPE(BetterSongSearch::UI::ViewControllers, DownloadHistoryViewController
 
 // TODO: Make entry access thread safe
 void errored(std::string message, DownloadHistoryEntry* entry) {
-    entry->status = DownloadHistoryEntry::DownloadStatus::Failed;
+    entry->SetStatus(DownloadHistoryEntry::DownloadStatus::Failed);
     entry->statusDetails = fmt::format(": {}", message);
     entry->retries = 69;
 }
@@ -98,12 +98,12 @@ void ViewControllers::DownloadHistoryViewController::SelectSong(HMUI::TableView*
     INFO("Selecting a song {}", entry->songName);
 
     // If downloaded then select the song
-    if (entry->status == DownloadHistoryEntry::DownloadStatus::Downloaded) {
+    if (entry->GetStatus() == DownloadHistoryEntry::DownloadStatus::Downloaded) {
         DEBUG("DOWNLOADED");
         auto controller = fcInstance->SongListController;
         controller->SelectSongByHash(entry->hash);
         controller->songListTable()->ClearSelection();
-    } else if (entry->status == DownloadHistoryEntry::DownloadStatus::Failed) {
+    } else if (entry->GetStatus() == DownloadHistoryEntry::DownloadStatus::Failed) {
         entry->retries = 0;
         ProcessDownloads(true);
     }
@@ -133,11 +133,8 @@ HMUI::TableCell* ViewControllers::DownloadHistoryViewController::CellForIdx(HMUI
 bool ViewControllers::DownloadHistoryViewController::TryAddDownload(SongDetailsCache::Song const* song, bool isBatch) {
     DownloadHistoryEntry* existingDLHistoryEntry = nullptr;
 
-    for (auto entry : downloadEntryList) {
-        if (entry->key == song->key()) {
-            existingDLHistoryEntry = entry;
-            break;
-        }
+    if (auto it = entriesByKey.find(std::string(song->key())); it != entriesByKey.end()) {
+        existingDLHistoryEntry = it->second;
     }
 
     if (existingDLHistoryEntry) {
@@ -150,11 +147,11 @@ bool ViewControllers::DownloadHistoryViewController::TryAddDownload(SongDetailsC
 
     if (existingDLHistoryEntry == nullptr) {
         // var newPos = downloadList.FindLastIndex(x => x.status > DownloadHistoryEntry.DownloadStatus.Queued);
-        downloadEntryList.push_back(new DownloadHistoryEntry(song));
+        AddEntry(new DownloadHistoryEntry(song));
         downloadHistoryTable()->ReloadData();
         downloadHistoryTable()->ScrollToCellWithIdx(0, HMUI::TableView::ScrollPositionType::Beginning, false);
     } else {
-        existingDLHistoryEntry->status = DownloadHistoryEntry::DownloadStatus::Queued;
+        existingDLHistoryEntry->SetStatus(DownloadHistoryEntry::DownloadStatus::Queued);
     }
 
     ProcessDownloads(!isBatch);
@@ -168,14 +165,7 @@ void ViewControllers::DownloadHistoryViewController::ProcessDownloads(bool force
     }
 
     // Count the ones  that need to be downloaded
-    int count = 0;
-    for (auto entry : downloadEntryList) {
-        if (entry->IsInAnyOfStates((DownloadHistoryEntry::DownloadStatus)(
-                DownloadHistoryEntry::DownloadStatus::Preparing | DownloadHistoryEntry::DownloadStatus::Downloading
-            ))) {
-            count++;
-        }
-    }
+    int count = statusCounters.Count(DownloadHistoryEntry::DownloadStatus::Preparing | DownloadHistoryEntry::DownloadStatus::Downloading);
     if (count >= MAX_PARALLEL_DOWNLOADS) {
         if (forceTableReload) {
             this->RefreshTable();
@@ -204,11 +194,11 @@ void ViewControllers::DownloadHistoryViewController::ProcessDownloads(bool force
     }
 
     // We have the entry, now we need to download
-    if (currentEntry->status == DownloadHistoryEntry::DownloadStatus::Failed) {
+    if (currentEntry->GetStatus() == DownloadHistoryEntry::DownloadStatus::Failed) {
         currentEntry->retries++;
     }
     currentEntry->downloadProgress = 0.0f;
-    currentEntry->status = DownloadHistoryEntry::DownloadStatus::Preparing;
+    currentEntry->SetStatus(DownloadHistoryEntry::DownloadStatus::Preparing);
     currentEntry->lastUpdate = CurrentTimeMs();
     RefreshTable(true);
 
@@ -238,7 +228,7 @@ void ViewControllers::DownloadHistoryViewController::ProcessDownloads(bool force
     DEBUG("Hash {}", currentEntry->hash);
 
     currentEntry->downloadProgress = 0.0f;
-    currentEntry->status = DownloadHistoryEntry::DownloadStatus::Downloading;
+    currentEntry->SetStatus(DownloadHistoryEntry::DownloadStatus::Downloading);
 
     RefreshTable(true);
 
@@ -310,7 +300,7 @@ void ViewControllers::DownloadHistoryViewController::ProcessDownloads(bool force
                 RefreshTable(true);
                 this->ProcessDownloads(forceTableReload);
             } else {
-                currentEntry->status = DownloadHistoryEntry::DownloadStatus::Downloaded;
+                currentEntry->SetStatus(DownloadHistoryEntry::DownloadStatus::Downloaded);
                 currentEntry->statusDetails = "";
                 currentEntry->downloadProgress = 1.0f;
                 DEBUG("Success downloading the song");
@@ -330,7 +320,7 @@ void ViewControllers::DownloadHistoryViewController::ProcessDownloads(bool force
             if (fcInstance && fcInstance->SongListController) {
                 auto currentSong = fcInstance->SongListController->GetCurrentSong();
                 if (currentSong != nullptr) {
-                    if (currentEntry->status == DownloadHistoryEntry::DownloadStatus::Downloaded) {
+                    if (currentEntry->GetStatus() == DownloadHistoryEntry::DownloadStatus::Downloaded) {
                         // NESTING HELLLL
                         if (currentSong->hash() == currentEntry->hash) {
                             fcInstance->SongListController->SetIsDownloaded(true);
@@ -367,12 +357,16 @@ bool ViewControllers::DownloadHistoryViewController::CheckIsDownloadedAndLoaded(
 };
 
 DownloadHistoryEntry* ViewControllers::DownloadHistoryViewController::GetDownloadByHash(std::string hash) {
-    for (auto entry : this->downloadEntryList) {
-        if (entry->hash == hash) {
-            return entry;
-        }
-    }
-    return nullptr;
+    auto it = entriesByHash.find(hash);
+    return it != entriesByHash.end() ? it->second : nullptr;
+}
+
+void ViewControllers::DownloadHistoryViewController::AddEntry(DownloadHistoryEntry* entry) {
+    entry->counters = &statusCounters;
+    statusCounters.Add(entry->GetStatus(), 1);
+    downloadEntryList.push_back(entry);
+    entriesByHash.emplace(entry->hash, entry);
+    entriesByKey.emplace(entry->key, entry);
 }
 
 bool ViewControllers::DownloadHistoryViewController::CheckIsDownloadable(DownloadHistoryEntry* entry) {
@@ -380,7 +374,7 @@ bool ViewControllers::DownloadHistoryViewController::CheckIsDownloadable(Downloa
     if (dlElem == nullptr) {
         return true;
     }
-    if (dlElem->retries == 3 && dlElem->status == DownloadHistoryEntry::DownloadStatus::Failed) {
+    if (dlElem->retries == 3 && dlElem->GetStatus() == DownloadHistoryEntry::DownloadStatus::Failed) {
         return true;
     }
 
@@ -399,7 +393,7 @@ bool ViewControllers::DownloadHistoryViewController::CheckIsDownloaded(std::stri
     auto entry = this->GetDownloadByHash(songHash);
     bool downloadedInList = false;
 
-    if (entry != nullptr && entry->status == DownloadHistoryEntry::DownloadStatus::Downloaded) {
+    if (entry != nullptr && entry->GetStatus() == DownloadHistoryEntry::DownloadStatus::Downloaded) {
         downloadedInList = true;
     };
     return (downloadedInList || CheckIsDownloadedAndLoaded(songHash));
@@ -411,12 +405,5 @@ bool ViewControllers::DownloadHistoryViewController::CheckIsDownloadable(std::st
 }
 
 bool ViewControllers::DownloadHistoryViewController::HasPendingDownloads() {
-    for (auto entry : downloadEntryList) {
-        if (entry->IsInAnyOfStates((DownloadHistoryEntry::DownloadStatus)(
-                DownloadHistoryEntry::DownloadStatus::Downloading | DownloadHistoryEntry::DownloadStatus::Queued
-            ))) {
-            return true;
-        }
-    }
-    return false;
+    return statusCounters.Count(DownloadHistoryEntry::DownloadStatus::Downloading | DownloadHistoryEntry::DownloadStatus::Queued) > 0;
 };
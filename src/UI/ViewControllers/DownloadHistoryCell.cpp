@@ -25,8 +25,8 @@ namespace BetterSongSearch::UI::ViewControllers {
         if (!entry) {
             return;
         }
-        auto clr = entry->status == DownloadHistoryEntry::Failed                 ? UnityEngine::Color::get_red()
-                 : entry->status != DownloadHistoryEntry::DownloadStatus::Queued ? UnityEngine::Color::get_green()
+        auto clr = entry->GetStatus() == DownloadHistoryEntry::Failed                 ? UnityEngine::Color::get_red()
+                 : entry->GetStatus() != DownloadHistoryEntry::DownloadStatus::Queued ? UnityEngine::Color::get_green()
                                                                                  : UnityEngine::Color::get_gray();
         clr.a = 0.5f + (entry->downloadProgress * 0.4f);
         bgProgress->set_color(clr);
@@ -609,5 +609,8 @@ void ViewControllers::FilterViewController::OnFailed(std::string message) {
 }
 
 void ViewControllers::FilterViewController::OnSearchComplete() {
+    if (dataHolder.IsDisplayedSongListPartial()) {
+        return;
+    }
     INFO("Search complete");
 }
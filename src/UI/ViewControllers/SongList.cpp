@@ -27,6 +27,7 @@
 #include "GlobalNamespace/SongPreviewPlayer.hpp"
 #include "HMUI/CurvedTextMeshPro.hpp"
 #include "HMUI/InputFieldViewChangeBinder.hpp"
+#include "HMUI/ScrollView.hpp"
 #include "HMUI/TableView.hpp"
 #include "logging.hpp"
 #include "PluginConfig.hpp"
@@ -43,6 +44,8 @@
 #include "UnityEngine/Resources.hpp"
 #include "UnityEngine/WaitForSeconds.hpp"
 #include "Util/BSMLStuff.hpp"
+#include "Util/CoverCache.hpp"
+#include "Util/CoverPrefetcher.hpp"
 #include "Util/CurrentTimeMs.hpp"
 #include "Util/Debug.hpp"
 #include "Util/Random.hpp"
@@ -75,13 +78,22 @@ std::vector<std::string> const DIFFS = {"Easy", "Normal", "Hard", "Expert", "Exp
 std::vector<std::string> const REQUIREMENTS = {"Any", "Noodle Extensions", "Mapping Extensions", "Chroma", "Cinema"};
 
 void ViewControllers::SongListController::_UpdateSearchedSongsList() {
+    searchDebounce.MarkFired();
     dataHolder.Search();
 }
 
 void ViewControllers::SongListController::UpdateSearchedSongsList() {
+    // Searches are fast right now (cached or indexed), don't wait for the next frame
+    if (!limitedUpdateSearchedSongsList->wasRecentlyExecuted && searchDebounce.CanFireImmediately(!dataHolder.searchInProgress)) {
+        this->StartCoroutine(custom_types::Helpers::CoroutineHelper::New(limitedUpdateSearchedSongsList->Call()));
+        return;
+    }
     this->StartCoroutine(custom_types::Helpers::CoroutineHelper::New(limitedUpdateSearchedSongsList->CallNextFrame()));
 }
 
+// Seconds between cover prefetches while the list scrolls
+static constexpr float PREFETCH_INTERVAL = 0.3f;
+
 void ViewControllers::SongListController::PostParse() {
     // Steal search box from the base game
     UnityW<HMUI::InputFieldView> gameSearchBox;
@@ -113,7 +125,7 @@ void ViewControllers::SongListController::PostParse() {
     // Get the default cover image
     defaultImage = BSML::Utilities::LoadSpriteRaw(Assets::CustomLevelsCover_png);
     // Set default cover image
-    coverImage->set_sprite(defaultImage);
+    this->SetCoverSprite(defaultImage);
 
     // Get song preview player
     songPreviewPlayer = BSML::Helpers::GetDiContainer()->Resolve<SongPreviewPlayer*>();
@@ -138,6 +150,24 @@ void ViewControllers::SongListController::PostParse() {
 
     if (this->songList) {
         songList->tableView->SetDataSource(reinterpret_cast<HMUI::TableView::IDataSource*>(this), false);
+
+        // The scroll event fires every frame of a scroll, covers are prefetched at most every PREFETCH_INTERVAL and once more after it stops
+        if (limitedUpdateCoverPrefetch == nullptr) {
+            limitedUpdateCoverPrefetch = new BetterSongSearch::Util::RatelimitCoroutine(
+                [this]() {
+                    this->UpdateCoverPrefetch();
+                },
+                PREFETCH_INTERVAL
+            );
+        }
+        std::function<void(float)> onScroll = [this](float) {
+            if (limitedUpdateCoverPrefetch->wasRecentlyExecuted) {
+                limitedUpdateCoverPrefetch->queuedFallingEdge = true;
+                return;
+            }
+            this->StartCoroutine(custom_types::Helpers::CoroutineHelper::New(limitedUpdateCoverPrefetch->Call()));
+        };
+        songList->tableView->____scrollView->add_scrollPositionChangedEvent(BSML::MakeSystemAction(onScroll));
     }
 }
 
@@ -161,7 +191,9 @@ void ViewControllers::SongListController::DidActivate(bool firstActivation, bool
                 DEBUG("UpdateSearchedSongsList limited called");
                 this->_UpdateSearchedSongsList();
             },
-            0.1f
+            [this]() {
+                return searchDebounce.WindowMs() / 1000.0f;
+            }
         );
 
         IsSearching = false;
@@ -202,6 +234,11 @@ void ViewControllers::SongListController::DidActivate(bool firstActivation, bool
 
     fromBSS = false;
 
+    // Songs loaded while the list was hidden didn't update the cells
+    if (!firstActivation) {
+        RefreshDownloadStates();
+    }
+
     // Retry if failed to dl
     this->RetryDownloadSongList();
 
@@ -231,13 +268,13 @@ void ViewControllers::SongListController::SelectSongByHash(std::string hash) {
     }
 
     DEBUG("Song hash: {}", hash);
-    auto& song = dataHolder.songDetails->songs.FindByHash(hash);
-    if (song == SongDetailsCache::Song::none) {
+    auto song = dataHolder.FindSongByHash(hash);
+    if (song == nullptr) {
         DEBUG("Uh oh, you somehow downloaded a song that was only a figment of your imagination");
         return;
     }
 
-    SetSelectedSong(&song);
+    SetSelectedSong(song);
 }
 
 void ViewControllers::SongListController::SelectSong(UnityW<HMUI::TableView> table, int id) {
@@ -252,6 +289,9 @@ void ViewControllers::SongListController::SelectSong(UnityW<HMUI::TableView> tab
     }
     DEBUG("Selecting song {}", id);
     this->SetSelectedSong(song);
+
+    prefetchSelectedIdx = id;
+    this->UpdateCoverPrefetch();
 }
 
 float ViewControllers::SongListController::CellSize() {
@@ -267,6 +307,92 @@ void ViewControllers::SongListController::ResetTable() {
     }
 }
 
+// A refresh only moves a few songs, the top visible song is looked for this far down the new list
+static constexpr int REFRESH_ANCHOR_SEARCH_WINDOW = 500;
+
+void ViewControllers::SongListController::RefreshTableKeepingPosition() {
+    auto table = songListTable();
+    if (table == nullptr) {
+        return;
+    }
+
+    auto range = table->GetVisibleCellsIdRange();
+    int firstVisible = std::max(range->get_Item1(), 0);
+    int lastVisible = std::max(range->get_Item2(), firstVisible);
+    int length = dataHolder.GetDisplayedSongListLength();
+
+    // Nothing on screen moved, only the cells need their texts and colors updated
+    std::size_t firstChanged = dataHolder.GetFirstChangedDisplayedIndex(lastVisible + 1);
+    if (firstChanged > static_cast<std::size_t>(lastVisible)) {
+        if (length == table->get_numberOfCells()) {
+            table->RefreshCells(false, true);
+        } else {
+            table->ReloadDataKeepingPosition();
+        }
+        DEBUG("Refreshed the table in place, first change at {}", firstChanged);
+        return;
+    }
+
+    // Keep the song at the top of the list where it is, wherever it moved to
+    std::size_t anchor = dataHolder.MapPreviousDisplayedIndex(firstVisible, firstVisible + REFRESH_ANCHOR_SEARCH_WINDOW);
+    if (anchor == SIZE_MAX) {
+        DEBUG("Top visible song {} is gone from the refreshed list, resetting the table", firstVisible);
+        this->ResetTable();
+        return;
+    }
+    table->ReloadData();
+    table->ScrollToCellWithIdx(anchor, HMUI::TableView::ScrollPositionType::Beginning, false);
+    DEBUG("Refreshed the table, top visible song moved from {} to {}", firstVisible, anchor);
+}
+
+// Covers of the rows around the selection and of the next rows below the visible ones are fetched ahead
+static constexpr int PREFETCH_NEIGHBORS = 3;
+static constexpr int PREFETCH_AHEAD = 8;
+
+void ViewControllers::SongListController::UpdateCoverPrefetch() {
+    auto table = songListTable();
+    int length = dataHolder.GetDisplayedSongListLength();
+    if (table == nullptr || length == 0) {
+        GetCoverPrefetcher().Cancel();
+        return;
+    }
+
+    auto range = table->GetVisibleCellsIdRange();
+    int firstVisible = std::clamp(range->get_Item1(), 0, length - 1);
+    int lastVisible = std::clamp(range->get_Item2(), firstVisible, length - 1);
+
+    std::vector<int> rows;
+    if (prefetchSelectedIdx >= 0 && prefetchSelectedIdx < length) {
+        for (int distance = 1; distance <= PREFETCH_NEIGHBORS; distance++) {
+            rows.push_back(prefetchSelectedIdx + distance);
+            rows.push_back(prefetchSelectedIdx - distance);
+        }
+    }
+    for (int idx = firstVisible; idx <= lastVisible + PREFETCH_AHEAD; idx++) {
+        rows.push_back(idx);
+    }
+
+    std::vector<std::string> hashes;
+    for (int idx : rows) {
+        if (idx < 0 || idx >= length) {
+            continue;
+        }
+        auto song = dataHolder.GetDisplayedSongByIndex(idx);
+        if (song == nullptr) {
+            continue;
+        }
+        // Downloaded songs have their cover in their folder
+        if (SongCore::API::Loading::GetLevelByHash(std::string(song->hash())) != nullptr) {
+            continue;
+        }
+        auto hash = toLower(song->hash());
+        if (std::find(hashes.begin(), hashes.end(), hash) == hashes.end()) {
+            hashes.push_back(std::move(hash));
+        }
+    }
+    GetCoverPrefetcher().Prefetch(std::move(hashes));
+}
+
 int ViewControllers::SongListController::NumberOfCells() {
     return dataHolder.GetDisplayedSongListLength();
 }
@@ -292,6 +418,18 @@ void ViewControllers::SongListController::OnDestroy() {
     dataHolder.loadingFailed -= {&ViewControllers::SongListController::SongDataError, this};
     dataHolder.searchEnded -= {&ViewControllers::SongListController::SearchDone, this};
     dataHolder.playerDataLoaded -= {&ViewControllers::SongListController::PlayerDataLoaded, this};
+
+    GetCoverPrefetcher().Cancel();
+    BetterSongSearch::Util::CoverCache::DestroySprite(ownedCover);
+    ownedCover = nullptr;
+}
+
+void ViewControllers::SongListController::SetCoverSprite(UnityW<UnityEngine::Sprite> sprite, bool owned) {
+    this->coverImage->set_sprite(sprite);
+    if (ownedCover && ownedCover.ptr() != sprite.ptr()) {
+        BetterSongSearch::Util::CoverCache::DestroySprite(ownedCover);
+    }
+    ownedCover = owned ? sprite : nullptr;
 }
 
 void ViewControllers::SongListController::SelectRandom() {
@@ -415,6 +553,27 @@ void GetByURLAsync(std::string url, std::function<void(bool success, std::vector
     }).detach();
 }
 
+// Reads the cover from the disk cache or downloads and stores it
+void GetCoverAsync(std::string hash, std::function<void(bool success, std::vector<uint8_t>)> finished) {
+    std::thread([hash, finished] {
+        auto cached = GetCoverCache().ReadCompressed(hash);
+        if (cached) {
+            finished(true, std::move(*cached));
+            return;
+        }
+
+        std::string url = fmt::format("{}/{}.jpg", BeatSaverRegionManager::coverDownloadUrl, hash);
+        DEBUG("{}", url);
+        GetByURLAsync(url, [hash, finished](bool success, std::vector<uint8_t> bytes) {
+            if (success) {
+                GetCoverPrefetcher().Charge(bytes.size());
+                GetCoverCache().WriteCompressed(hash, bytes);
+            }
+            finished(success, std::move(bytes));
+        });
+    }).detach();
+}
+
 custom_types::Helpers::Coroutine GetPreview(std::string url, std::function<void(UnityW<UnityEngine::AudioClip>)> finished) {
     auto webRequest = UnityEngine::Networking::UnityWebRequestMultimedia::GetAudioClip(url, UnityEngine::AudioType::MPEG);
     co_yield reinterpret_cast<System::Collections::IEnumerator*>(CRASH_UNLESS(webRequest->SendWebRequest()));
@@ -588,72 +747,49 @@ void ViewControllers::SongListController::UpdateDetails() {
     // This part below is here to not break anything on return
 #ifdef SONGDOWNLOADER
 
-    // if beatmap is loaded
-    if (loaded) {
-        // Get old sprite if it exists
-        UnityW<UnityEngine::Sprite> oldSprite = this->coverImage->get_sprite();
-
+    // Covers are owned by the cache, recently shown ones come back without decoding or downloading
+    std::string coverHash = toLower(song->hash());
+    if (auto cached = GetCoverCache().GetSprite(coverHash)) {
+        this->SetCoverSprite(cached);
+        coverLoading->set_enabled(false);
+    } else if (loaded) {
         auto cover = BetterSongSearch::Util::getLocalCoverSync(beatmap);
         if (cover) {
-            this->coverImage->set_sprite(cover);
+            bool cached = GetCoverCache().PutSprite(coverHash, cover);
+            this->SetCoverSprite(cover, !cached);
         } else {
-            this->coverImage->set_sprite(defaultImage);
-
-            // Cleanup old sprite
-            if (oldSprite && oldSprite.ptr() != defaultImage.ptr()) {
-                UnityW<UnityEngine::Texture2D> texture = oldSprite->get_texture();
-                if (texture) {
-                    UnityEngine::Object::DestroyImmediate(texture);
-                }
-                UnityEngine::Object::DestroyImmediate(oldSprite);
-            }
+            this->SetCoverSprite(defaultImage);
         }
         coverLoading->set_enabled(false);
     } else {
-        std::string newUrl = fmt::format("{}/{}.jpg", BeatSaverRegionManager::coverDownloadUrl, toLower(song->hash()));
-        DEBUG("{}", newUrl.c_str());
         coverLoading->set_enabled(true);
-        GetByURLAsync(newUrl, [this, song](bool success, std::vector<uint8_t> bytes) {
-            BSML::MainThreadScheduler::Schedule([this, bytes, song, success] {
-                // Get old sprite if it exists
-                UnityW<UnityEngine::Sprite> oldSprite = this->coverImage->get_sprite();
+        GetCoverAsync(coverHash, [this, song, coverHash](bool success, std::vector<uint8_t> bytes) {
+            BSML::MainThreadScheduler::Schedule([this, bytes = std::move(bytes), song, coverHash, success] {
+                auto currentSong = GetCurrentSong();
+                // Return if the song has changed somehow, the cover stays on disk for next time
+                if (currentSong == nullptr) {
+                    return;
+                }
+                if (song->hash() != currentSong->hash()) {
+                    return;
+                }
                 if (success) {
-                    std::vector<uint8_t> data = bytes;
                     DEBUG("Image size: {}", pretty_bytes(bytes.size()));
-                    auto currentSong = GetCurrentSong();
-                    // Return if the song has changed somehow
-                    if (currentSong == nullptr) {
-                        return;
-                    }
-                    if (song->hash() != currentSong->hash()) {
-                        return;
-                    }
-                    auto spriteArray = ArrayW(data);
-                    UnityW<UnityEngine::Sprite> sprite = BSML::Lite::ArrayToSprite(spriteArray);
+                    bool cached = true;
+                    UnityW<UnityEngine::Sprite> sprite = GetCoverCache().AddSprite(coverHash, bytes, cached);
                     if (sprite) {
                         DEBUG("Setting sprite");
-                        this->coverImage->set_sprite(sprite);
+                        this->SetCoverSprite(sprite, !cached);
                     } else {
                         WARNING("Setting default image, sprite was invalid");
-                        this->coverImage->set_sprite(defaultImage);
+                        this->SetCoverSprite(defaultImage);
                     }
                 } else {
-                    this->coverImage->set_sprite(defaultImage);
+                    this->SetCoverSprite(defaultImage);
                 }
 
                 // Disable loading animation
                 coverLoading->set_enabled(false);
-
-                // Cleanup old sprite
-                if (oldSprite && oldSprite.ptr() != defaultImage.ptr() &&  // Old sprite is not default image
-                    this->coverImage->get_sprite().ptr() != oldSprite.ptr()  // Old sprite is not the current sprite
-                ) {
-                    UnityW<UnityEngine::Texture2D> texture = oldSprite->get_texture();
-                    if (texture) {
-                        UnityEngine::Object::DestroyImmediate(texture);
-                    }
-                    UnityEngine::Object::DestroyImmediate(oldSprite);
-                }
             });
         });
     }
@@ -701,7 +837,14 @@ void ViewControllers::SongListController::FilterByUploader() {
 }
 
 // BSML::CustomCellInfo
+// Rows before the end of the list at which more relevance results are ranked
+static constexpr int LOAD_MORE_RESULTS_MARGIN = 16;
+
 HMUI::TableCell* ViewControllers::SongListController::CellForIdx(HMUI::TableView* tableView, int idx) {
+    // Relevance results past the ranked ones are only ranked when the end of the list comes into view
+    if (idx + LOAD_MORE_RESULTS_MARGIN >= static_cast<int>(dataHolder.GetDisplayedSongListLength())) {
+        dataHolder.LoadMoreResults();
+    }
     auto song = dataHolder.GetDisplayedSongByIndex(idx);
     return ViewControllers::SongListTableData::GetCell(tableView)->PopulateWithSongData(song);
 }
@@ -767,14 +910,32 @@ void ViewControllers::SongListController::SearchDone() {
         return;
     }
 
+    bool partial = dataHolder.IsDisplayedSongListPartial();
+    uint32_t searchId = dataHolder.GetDisplayedSearchId();
+
     long long before = 0;
     before = CurrentTimeMs();
-    this->ResetTable();
-    INFO("table reset in {} ms", CurrentTimeMs() - before);
+    if (searchId == shownSearchId) {
+        // More results of the search that is already shown, don't throw the user back to the top
+        songListTable()->ReloadDataKeepingPosition();
+    } else if (shownSearchId != 0 && dataHolder.IsDisplayedSongListRefresh()) {
+        // Same query with new scores, downloads or stars, the user stays where they were
+        this->RefreshTableKeepingPosition();
+    } else {
+        // Another result set, the clicked row means nothing in it
+        prefetchSelectedIdx = -1;
+        this->ResetTable();
+    }
+    shownSearchId = searchId;
+    INFO("table reset in {} ms (partial: {})", CurrentTimeMs() - before, partial);
 
     if (songSearchPlaceholder) {
-        if (dataHolder.GetDisplayedSongListLength() == dataHolder.songDetails->songs.size()) {
+        if (partial) {
+            songSearchPlaceholder->set_text(fmt::format("Searching... {} songs so far", dataHolder.GetDisplayedSongListLength()));
+        } else if (dataHolder.GetDisplayedSongListLength() == dataHolder.songDetails->songs.size()) {
             songSearchPlaceholder->set_text("Search by Song, Key, Mapper..");
+        } else if (dataHolder.HasMoreResults()) {
+            songSearchPlaceholder->set_text(fmt::format("Search {}+ songs", dataHolder.GetDisplayedSongListLength()));
         } else {
             songSearchPlaceholder->set_text(fmt::format("Search {} songs", dataHolder.GetDisplayedSongListLength()));
         }
@@ -789,6 +950,17 @@ void ViewControllers::SongListController::SearchDone() {
         songListTable()->ClearSelection();
     }
 
+    // The search is still running and will publish again
+    if (partial) {
+        return;
+    }
+
+    // What was queued is for the old rows
+    this->UpdateCoverPrefetch();
+
+    searchDebounce.RecordLatency(dataHolder.lastSearchDurationMs);
+    DEBUG("Search took {} ms, debounce window is {} ms", dataHolder.lastSearchDurationMs.load(), searchDebounce.WindowMs());
+
     this->searchInProgress->get_gameObject()->set_active(false);
 
     // Run search again if something wants to
@@ -835,33 +1007,52 @@ void ViewControllers::SongListController::PlayerDataLoaded() {
 }
 
 void ViewControllers::SongListController::OnSongsLoaded(std::span<SongCore::SongLoader::CustomBeatmapLevel* const> songs) {
-    auto currentSong = GetCurrentSong();
+    // Download filters depend on the loaded songs
+    dataHolder.InvalidateSearchCache();
+
     if (dataHolder.songDetails == nullptr) {
         return;
     }
     if (!dataHolder.songDetails->songs.get_isDataAvailable()) {
         return;
     }
-    if (currentSong == nullptr) {
-        return;
-    }
 
     // Ensure it runs on the main thread
     bool isMainThread = BSML::MainThreadScheduler::CurrentThreadIsMainThread();
     if (!isMainThread) {
         ERROR("Calling OnSongsLoaded not on the main thread, sending to main thread");
-        BSML::MainThreadScheduler::Schedule([this, songs] {
-            this->OnSongsLoaded(songs);
+        BSML::MainThreadScheduler::Schedule([this] {
+            this->RefreshDownloadStates();
         });
         return;
     }
 
-    auto song = currentSong;
-    DEBUG("Song index is: {}", song->index);
-    auto beatmap = SongCore::API::Loading::GetLevelByHash(std::string(song->hash()));
-    bool loaded = beatmap != nullptr;
+    DEBUG("{} songs loaded", songs.size());
+    RefreshDownloadStates();
+}
+
+void ViewControllers::SongListController::RefreshDownloadStates() {
+    auto currentSong = GetCurrentSong();
+    if (currentSong != nullptr) {
+        DEBUG("Song index is: {}", currentSong->index);
+        auto beatmap = SongCore::API::Loading::GetLevelByHash(std::string(currentSong->hash()));
+        SetIsDownloaded(beatmap != nullptr);
+    }
 
-    SetIsDownloaded(loaded);
+    // Only the visible cells whose downloaded state changed get a new color, the cells are not repopulated
+    auto table = songListTable();
+    if (!table || !this->get_isActiveAndEnabled()) {
+        return;
+    }
+    int changed = 0;
+    for (auto cell : table->GetComponentsInChildren<ViewControllers::CustomSongListTableCell*>()) {
+        bool wasDownloaded = cell->shownAsDownloaded;
+        cell->RefreshDownloadState();
+        if (cell->shownAsDownloaded != wasDownloaded) {
+            changed++;
+        }
+    }
+    DEBUG("Updated the downloaded state of {} cells", changed);
 }
 
 SongDetailsCache::Song const* ViewControllers::SongListController::GetCurrentSong() {
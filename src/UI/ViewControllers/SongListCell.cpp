@@ -8,9 +8,9 @@
 #include "PluginConfig.hpp"
 #include "sombrero/shared/FastColor.hpp"
 #include "song-details/shared/Data/MapCharacteristic.hpp"
-#include "songcore/shared/SongLoader/RuntimeSongLoader.hpp"
 #include "UI/FlowCoordinators/BetterSongSearchFlowCoordinator.hpp"
 #include "UnityEngine/Color.hpp"
+#include "Util/LRUCache.hpp"
 #include "Util/SongUtil.hpp"
 
 using namespace BetterSongSearch::Util;
@@ -23,6 +23,36 @@ struct DiffIndex {
     float stars;
 };
 
+// Preformatted texts of a cell
+struct CellViewModel {
+    std::string levelAuthorName;
+    std::string songLengthAndRating;
+    std::string uploadDateFormatted;
+    std::string fullFormattedSongName;
+    std::vector<std::string> diffLabels;  // One per active difficulty label
+    bool hasMoreLabel = false;  // Last label is the "N More" one
+    bool isCurated = false;
+    bool isVerified = false;
+};
+
+// Everything the view model depends on besides the song
+struct CellViewModelKey {
+    uint32_t songIndex;
+    uint32_t filterGeneration;
+    FilterTypes::SortMode sort;
+    bool smallFont;
+
+    bool operator==(CellViewModelKey const&) const = default;
+};
+
+struct CellViewModelKeyHash {
+    std::size_t operator()(CellViewModelKey const& key) const {
+        uint64_t packed = (static_cast<uint64_t>(key.songIndex) << 32) ^ (static_cast<uint64_t>(key.filterGeneration) << 8) ^
+                          (static_cast<uint64_t>(key.sort) << 1) ^ static_cast<uint64_t>(key.smallFont);
+        return std::hash<uint64_t>{}(packed);
+    }
+};
+
 namespace BetterSongSearch::UI::ViewControllers {
     static std::map<SongDetailsCache::MapDifficulty const, std::string> shortMapDiffNames = {
         {SongDetailsCache::MapDifficulty::Easy, "Easy"},
@@ -53,30 +83,100 @@ namespace BetterSongSearch::UI::ViewControllers {
         return retVal;
     }
 
+    // Shared by all cells, only used on the main thread
+    static constexpr std::size_t CELL_VIEW_MODEL_CACHE_BYTES = 512 * 1024;
+    static Util::LRUCache<CellViewModelKey, CellViewModel, CellViewModelKeyHash> cellViewModels(CELL_VIEW_MODEL_CACHE_BYTES);
+
     void CustomSongListTableCell::ctor() {
-        // Subscribe to events
-        SongCore::SongLoader::RuntimeSongLoader::get_instance()->SongsLoaded += {&CustomSongListTableCell::OnSongsLoaded, this};
+        entry = nullptr;
+        shownAsDownloaded = false;
     }
 
-    void CustomSongListTableCell::OnDestroy() {
-        // Unsub from events
-        // The only way this can be destroyed is if the game is closing,
-        // so no need to unsub, since songcore will be destroyed too
+    void CustomSongListTableCell::RefreshDownloadState() {
+        if (!this->entry) {
+            return;
+        }
+        bool isDownloaded = fcInstance->DownloadHistoryViewController->CheckIsDownloaded(entry->hash());
+        if (isDownloaded != shownAsDownloaded) {
+            SetDownloadedColor(isDownloaded);
+        }
     }
 
-    void CustomSongListTableCell::OnSongsLoaded(std::span<SongCore::SongLoader::CustomBeatmapLevel* const> songs) {
-        if (!this->get_isActiveAndEnabled()) {
-            return;
+    void CustomSongListTableCell::SetDownloadedColor(bool isDownloaded) {
+        static auto verifiedSongColor = Sombrero::FastColor(.7f, 1.0f, .7f, 1.0f);
+
+        // Song name color
+        Sombrero::FastColor songColor = Sombrero::FastColor::white();
+        if (isDownloaded) {
+            songColor = Sombrero::FastColor(0.53f, 0.53f, 0.53f, 1.0f);
+        } else {
+            if (hasFlags(entry->uploadFlags, SongDetailsCache::UploadFlags::Curated)) {
+                songColor = verifiedSongColor;
+            }
         }
-        if (!dataHolder.songDetails->songs.get_isDataAvailable()) {
-            return;
+        this->fullFormattedSongName->set_color(songColor);
+        shownAsDownloaded = isDownloaded;
+    }
+
+    // Formats everything the cell shows that doesn't change while scrolling
+    static CellViewModel BuildViewModel(SongDetailsCache::Song const* entry, std::size_t labelCount) {
+        CellViewModel model;
+        model.isCurated = hasFlags(entry->uploadFlags, SongDetailsCache::UploadFlags::Curated);
+        model.isVerified = hasFlags(entry->uploadFlags, SongDetailsCache::UploadFlags::VerifiedUploader);
+        model.levelAuthorName = entry->levelAuthorName();
+        model.songLengthAndRating =
+            fmt::format("Length: {:%M:%S} Upvotes: {}, Downvotes: {}", std::chrono::seconds(entry->songDurationSeconds), entry->upvotes, entry->downvotes);
+        model.uploadDateFormatted = fmt::format("{:%d. %b %Y}", fmt::localtime(entry->uploadTimeUnix));
+        model.fullFormattedSongName = fmt::format("{} - {}", entry->songAuthorName(), entry->songName());
+
+        // Ordered in the background by the filter pass, only songs it didn't get to yet are ordered here
+        auto order = dataHolder.GetDiffLabelOrder(entry);
+        if (!order) {
+            auto result = dataHolder.GetDiffFilterResult(entry);
+            order = OrderDifficultyLabels(entry, dataHolder.currentSort, result ? &*result : nullptr);
         }
-        if (!this->entry) {
-            return;
+
+        std::vector<DiffIndex> sortedDiffs;
+        sortedDiffs.reserve(order->count);
+        for (std::size_t i = 0; i < order->count; i++) {
+            auto diff = &*entry->begin() + order->diffs[i];
+            sortedDiffs.push_back({diff, DifficultyPasses(diff, entry), getStars(diff)});
         }
 
-        // Refresh the state
-        PopulateWithSongData(this->entry);
+        int diffsLeft = entry->diffCount;
+        labelCount = std::min(labelCount, DiffLabelOrder::MAX_LABELS);
+
+        for (std::size_t i = 0; i < labelCount && diffsLeft != 0; i++) {
+            if (diffsLeft != 1 && i == labelCount - 1) {
+                model.diffLabels.push_back(fmt::format("<color=#0AD>{} More", diffsLeft));
+                model.hasMoreLabel = true;
+                break;
+            }
+            bool passesFilter = sortedDiffs[i].passesFilter;
+            auto diffname = GetCombinedShortDiffName(entry->diffCount, sortedDiffs[i].diff);
+            std::string stars = "";
+
+            auto lbsvc = GetTargetedRankLeaderboardService(sortedDiffs[i].diff);
+
+            if (lbsvc == RankedStates::ScoresaberRanked && sortedDiffs[i].diff->starsSS > 0) {
+                stars = fmt::format(" <color=#{}>{}", (passesFilter ? "D91" : "650"), fmt::format("{:.{}f}", sortedDiffs[i].stars, 1));
+            } else if (lbsvc == RankedStates::BeatleaderRanked && sortedDiffs[i].diff->starsBL > 0) {
+                stars = fmt::format(" <color=#{}>{}", (passesFilter ? "B1D" : "606"), fmt::format("{:.{}f}", sortedDiffs[i].stars, 1));
+            }
+            model.diffLabels.push_back(fmt::format("<color=#{}>{}</color>{}", (passesFilter ? "EEE" : "888"), diffname, stars));
+            diffsLeft--;
+        }
+
+        return model;
+    }
+
+    static std::size_t ViewModelBytes(CellViewModel const& model) {
+        std::size_t bytes = sizeof(CellViewModel) + model.levelAuthorName.capacity() + model.songLengthAndRating.capacity() +
+                            model.uploadDateFormatted.capacity() + model.fullFormattedSongName.capacity();
+        for (auto const& label : model.diffLabels) {
+            bytes += sizeof(std::string) + label.capacity();
+        }
+        return bytes;
     }
 
     CustomSongListTableCell* CustomSongListTableCell::PopulateWithSongData(SongDetailsCache::Song const* entry) {
@@ -86,104 +186,44 @@ namespace BetterSongSearch::UI::ViewControllers {
         }
 
         // Colors
-        static auto verifiedSongColor = Sombrero::FastColor(.7f, 1.0f, .7f, 1.0f);
         static auto verifiedUploaderColor = Sombrero::FastColor(.46f, .27f, .68f, 1.0f);
         static auto normalUploaderColor = Sombrero::FastColor(.8f, .8f, .8f, 1.0f);
 
-        bool isCurated = hasFlags(entry->uploadFlags, SongDetailsCache::UploadFlags::Curated);
-
-        this->levelAuthorName->set_text(entry->levelAuthorName());
-        this->songLengthAndRating->set_text(fmt::format(
-            "Length: {:%M:%S} Upvotes: {}, Downvotes: {}", std::chrono::seconds(entry->songDurationSeconds), entry->upvotes, entry->downvotes
-        ));
-        this->uploadDateFormatted->set_text(fmt::format("{:%d. %b %Y}", fmt::localtime(entry->uploadTimeUnix)));
-        bool isDownloaded = fcInstance->DownloadHistoryViewController->CheckIsDownloaded(entry->hash());
-
-        // Song name color
-        Sombrero::FastColor songColor = Sombrero::FastColor::white();
-        if (isDownloaded) {
-            songColor = Sombrero::FastColor(0.53f, 0.53f, 0.53f, 1.0f);
-        } else {
-            if (isCurated) {
-                songColor = verifiedSongColor;
+        // Strings are formatted once per song and search state, scrolling only assigns them
+        CellViewModelKey key{entry->index, dataHolder.GetFilterGeneration(), dataHolder.currentSort, getPluginConfig().SmallerFontSize.GetValue()};
+        auto model = cellViewModels.Get(key);
+        if (!model) {
+            auto built = BuildViewModel(entry, diffs.size());
+            auto bytes = ViewModelBytes(built);
+            cellViewModels.Put(key, std::move(built), bytes);
+            model = cellViewModels.Get(key);
+            if (!model) {
+                WARNING("Cell view model for song {} does not fit in the cache", entry->index);
+                return this;
             }
         }
-        this->fullFormattedSongName->set_text(fmt::format("{} - {}", entry->songAuthorName(), entry->songName()));
-        this->fullFormattedSongName->set_color(songColor);
+
+        this->levelAuthorName->set_text(model->levelAuthorName);
+        this->songLengthAndRating->set_text(model->songLengthAndRating);
+        this->uploadDateFormatted->set_text(model->uploadDateFormatted);
+        this->fullFormattedSongName->set_text(model->fullFormattedSongName);
 
         // Author color
-        bool isVerified = hasFlags(entry->uploadFlags, SongDetailsCache::UploadFlags::VerifiedUploader);
-        this->levelAuthorName->set_color(isVerified ? verifiedUploaderColor : normalUploaderColor);
+        this->levelAuthorName->set_color(model->isVerified ? verifiedUploaderColor : normalUploaderColor);
 
         this->entry = entry;
+        SetDownloadedColor(fcInstance->DownloadHistoryViewController->CheckIsDownloaded(entry->hash()));
 
-        std::vector<DiffIndex> sortedDiffs;
-        for (SongDetailsCache::SongDifficulty const& diff : *entry) {
-            sortedDiffs.push_back({&diff, DifficultyCheck(&diff, entry), getStars(&diff)});
-        };
-
-        // TODO: Actually sort diffs..
-        std::stable_sort(sortedDiffs.begin(), sortedDiffs.end(), [entry](DiffIndex const& a, DiffIndex const& b) {
-            auto diff1 = (a.passesFilter ? 1 : -3) + (a.diff->characteristic == SongDetailsCache::MapCharacteristic::Standard ? 1 : 0);
-            auto diff2 = (b.passesFilter ? 1 : -3) + (b.diff->characteristic == SongDetailsCache::MapCharacteristic::Standard ? 1 : 0);
-
-            // Descending
-            return diff1 > diff2;
-        });
-
-        // If most stars
-        if (dataHolder.currentSort == FilterTypes::SortMode::Most_Stars) {
-            std::stable_sort(sortedDiffs.begin(), sortedDiffs.end(), [entry](DiffIndex const& a, DiffIndex const& b) {
-                auto diff1 = -a.stars;
-                auto diff2 = -b.stars;
-
-                // Ascending
-                return diff1 < diff2;
-            });
-        }
-        // If least stars
-        if (dataHolder.currentSort == FilterTypes::SortMode::Least_Stars) {
-            std::stable_sort(sortedDiffs.begin(), sortedDiffs.end(), [entry](DiffIndex const& a, DiffIndex const& b) {
-                auto diff1 = a.stars > 0 ? a.stars : -420.0f;
-                auto diff2 = b.stars > 0 ? b.stars : -420.0f;
-                // Ascending
-                return diff1 < diff2;
-            });
-        }
-
-        // By ranked
-        std::stable_sort(sortedDiffs.begin(), sortedDiffs.end(), [entry](DiffIndex const& a, DiffIndex const& b) {
-            auto diff1 = a.stars > 0 ? 1 : 0;
-            auto diff2 = b.stars > 0 ? 1 : 0;
-            // Descending
-            return diff1 < diff2;
-        });
-
-        int diffsLeft = sortedDiffs.size();
-
-        for (int i = 0; i < diffs.size(); i++) {
-            bool isActive = diffsLeft != 0;
+        for (std::size_t i = 0; i < diffs.size(); i++) {
+            bool isActive = i < model->diffLabels.size();
             diffs[i]->get_gameObject()->set_active(isActive);
             if (!isActive) {
                 continue;
             }
-            if (diffsLeft != 1 && i == diffs.size() - 1) {
-                diffs[i]->set_text(fmt::format("<color=#0AD>{} More", diffsLeft));
+            if (model->hasMoreLabel && i == model->diffLabels.size() - 1) {
+                diffs[i]->set_text(model->diffLabels[i]);
             } else {
-                bool passesFilter = sortedDiffs[i].passesFilter;
-                auto diffname = GetCombinedShortDiffName(entry->diffCount, sortedDiffs[i].diff);
-                std::string stars = "";
-
-                auto lbsvc = GetTargetedRankLeaderboardService(sortedDiffs[i].diff);
-
-                if (lbsvc == RankedStates::ScoresaberRanked && sortedDiffs[i].diff->starsSS > 0) {
-                    stars = fmt::format(" <color=#{}>{}", (passesFilter ? "D91" : "650"), fmt::format("{:.{}f}", sortedDiffs[i].stars, 1));
-                } else if (lbsvc == RankedStates::BeatleaderRanked && sortedDiffs[i].diff->starsBL > 0) {
-                    stars = fmt::format(" <color=#{}>{}", (passesFilter ? "B1D" : "606"), fmt::format("{:.{}f}", sortedDiffs[i].stars, 1));
-                }
-                auto text = fmt::format("<color=#{}>{}</color>{}", (passesFilter ? "EEE" : "888"), diffname, stars);
-                diffs[i]->SetText(text, false);
-                diffsLeft--;
+                diffs[i]->SetText(model->diffLabels[i], false);
             }
         }
 
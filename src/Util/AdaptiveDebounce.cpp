@@ -0,0 +1,53 @@
+#include "Util/AdaptiveDebounce.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include "Util/CurrentTimeMs.hpp"
+
+namespace BetterSongSearch::Util {
+    AdaptiveDebounce::AdaptiveDebounce(std::function<long long()> clock) : clock(clock ? std::move(clock) : CurrentTimeMs) {}
+
+    void AdaptiveDebounce::RecordLatency(long long ms) {
+        samples[nextSample] = std::max(0ll, ms);
+        nextSample = (nextSample + 1) % SampleCount;
+        sampleCount = std::min(sampleCount + 1, SampleCount);
+    }
+
+    long long AdaptiveDebounce::Percentile(float fraction) const {
+        if (sampleCount == 0) {
+            return -1;
+        }
+        std::array<long long, SampleCount> sorted = samples;
+        auto end = sorted.begin() + sampleCount;
+        std::size_t rank = static_cast<std::size_t>(std::ceil(std::clamp(fraction, 0.0f, 1.0f) * sampleCount));
+        auto nth = sorted.begin() + (rank > 0 ? rank - 1 : 0);
+        std::nth_element(sorted.begin(), nth, end);
+        return *nth;
+    }
+
+    long long AdaptiveDebounce::WindowMs() const {
+        long long latency = Percentile(percentile);
+        if (latency < 0) {
+            return defaultWindowMs;
+        }
+        return std::clamp(static_cast<long long>(latency * latencyFactor), minWindowMs, maxWindowMs);
+    }
+
+    bool AdaptiveDebounce::CanFireImmediately(bool pipelineIdle) const {
+        if (!pipelineIdle) {
+            return false;
+        }
+        long long window = WindowMs();
+        if (window > cheapWindowMs) {
+            return false;
+        }
+        return !fired || clock() - lastFiredMs >= window;
+    }
+
+    void AdaptiveDebounce::MarkFired() {
+        lastFiredMs = clock();
+        fired = true;
+    }
+}  // namespace BetterSongSearch::Util
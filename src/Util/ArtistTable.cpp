@@ -0,0 +1,36 @@
+#include "Util/ArtistTable.hpp"
+
+namespace BetterSongSearch::Util {
+    void ArtistTable::Clear() {
+        ids.clear();
+        pendingIds.clear();
+        names.Clear();
+        songArtists.clear();
+    }
+
+    void ArtistTable::Add(std::string_view normalizedName) {
+        auto [it, inserted] = pendingIds.try_emplace(std::string(normalizedName), static_cast<uint32_t>(names.size()));
+        if (inserted) {
+            names.Push(normalizedName);
+        }
+        songArtists.push_back(it->second);
+    }
+
+    void ArtistTable::Finish() {
+        // The names column does not change anymore, so the lookup can use views into it
+        ids.clear();
+        ids.reserve(names.size());
+        for (uint32_t i = 0; i < names.size(); i++) {
+            ids.emplace(names.at(i), i);
+        }
+        pendingIds = {};
+    }
+
+    uint32_t ArtistTable::Find(std::string_view normalizedName) const {
+        auto it = ids.find(normalizedName);
+        if (it == ids.end()) {
+            return npos;
+        }
+        return it->second;
+    }
+}  // namespace BetterSongSearch::Util
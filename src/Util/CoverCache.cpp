@@ -0,0 +1,162 @@
+#include "Util/CoverCache.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <thread>
+
+#include "bsml/shared/BSML-Lite/Creation/Image.hpp"
+#include "logging.hpp"
+#include "main.hpp"
+#include "UnityEngine/Object.hpp"
+#include "UnityEngine/Texture2D.hpp"
+#include "Util/CurrentTimeMs.hpp"
+
+namespace BetterSongSearch::Util {
+    void CoverCache::DestroySprite(UnityW<UnityEngine::Sprite> sprite) {
+        if (!sprite) {
+            return;
+        }
+        UnityW<UnityEngine::Texture2D> texture = sprite->get_texture();
+        if (texture) {
+            UnityEngine::Object::DestroyImmediate(texture);
+        }
+        UnityEngine::Object::DestroyImmediate(sprite);
+    }
+
+    // Seconds are enough to order covers by use
+    static uint32_t Now() {
+        return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+    }
+
+    CoverCache::CoverCache() : sprites(MEMORY_MAX_BYTES, [](std::string const&, UnityW<UnityEngine::Sprite>& sprite) { DestroySprite(sprite); }) {}
+
+    UnityW<UnityEngine::Sprite> CoverCache::GetSprite(std::string const& hash) {
+        auto sprite = sprites.Get(hash);
+        if (sprite == nullptr) {
+            return nullptr;
+        }
+        // Something else destroyed it (scene cleanup), decode again
+        if (!*sprite) {
+            sprites.Erase(hash);
+            return nullptr;
+        }
+        return *sprite;
+    }
+
+    UnityW<UnityEngine::Sprite> CoverCache::AddSprite(std::string const& hash, std::span<uint8_t const> bytes, bool& cached) {
+        ArrayW<uint8_t> array(il2cpp_array_size_t(bytes.size()));
+        std::copy(bytes.begin(), bytes.end(), array.begin());
+        UnityW<UnityEngine::Sprite> sprite = BSML::Lite::ArrayToSprite(array);
+        if (!sprite) {
+            return nullptr;
+        }
+        cached = PutSprite(hash, sprite);
+        return sprite;
+    }
+
+    bool CoverCache::PutSprite(std::string const& hash, UnityW<UnityEngine::Sprite> sprite) {
+        // Replacing would leak the old sprite
+        auto cached = sprites.Get(hash);
+        if (cached != nullptr && cached->ptr() != sprite.ptr()) {
+            DestroySprite(*cached);
+        }
+        return sprites.Put(hash, sprite, SpriteBytes(sprite));
+    }
+
+    std::size_t CoverCache::SpriteBytes(UnityW<UnityEngine::Sprite> sprite) {
+        UnityW<UnityEngine::Texture2D> texture = sprite->get_texture();
+        if (!texture) {
+            return 0;
+        }
+        return static_cast<std::size_t>(texture->get_width()) * texture->get_height() * 4;
+    }
+
+    bool CoverCache::EnsureStoreOpen() {
+        if (store.IsOpen()) {
+            return true;
+        }
+        if (storeOpenTried) {
+            return false;
+        }
+        storeOpenTried = true;
+
+        std::string directory = getDataDir(modInfo);
+        std::error_code ec;
+        std::filesystem::create_directories(directory, ec);
+        if (!store.Open(directory + "/covers")) {
+            ERROR("Failed to open the cover store, covers will be downloaded every time");
+            return false;
+        }
+        if (store.RecoveredBytes() > 0) {
+            WARNING("Cover store had an unfinished write, dropped {} bytes", store.RecoveredBytes());
+        }
+        INFO("Cover store has {} covers, {} KB of {} KB used", store.size(), store.LiveBytes() / 1024, store.FileBytes() / 1024);
+        return true;
+    }
+
+    std::optional<std::vector<uint8_t>> CoverCache::ReadCompressed(std::string const& hash) {
+        std::lock_guard<std::mutex> lock(diskMutex);
+        if (!EnsureStoreOpen()) {
+            return std::nullopt;
+        }
+        auto bytes = store.Read(hash);
+        if (bytes) {
+            store.Touch(hash, Now());
+        }
+        return bytes;
+    }
+
+    bool CoverCache::HasCompressed(std::string const& hash) {
+        std::lock_guard<std::mutex> lock(diskMutex);
+        return EnsureStoreOpen() && store.Contains(hash);
+    }
+
+    void CoverCache::WriteCompressed(std::string const& hash, std::span<uint8_t const> bytes) {
+        std::lock_guard<std::mutex> lock(diskMutex);
+        if (!EnsureStoreOpen()) {
+            return;
+        }
+        if (!store.Write(hash, bytes, Now())) {
+            WARNING("Failed to store cover {}", hash);
+            return;
+        }
+        TrimStore();
+    }
+
+    void CoverCache::TrimStore() {
+        if (store.LiveBytes() > DISK_MAX_BYTES) {
+            auto entries = store.Entries();
+            std::sort(entries.begin(), entries.end(), [](auto const& a, auto const& b) {
+                return a.timestamp < b.timestamp;
+            });
+            for (auto const& entry : entries) {
+                if (store.LiveBytes() <= DISK_EVICT_TO_BYTES) {
+                    break;
+                }
+                store.Erase(entry.key);
+            }
+        }
+
+        if (!store.NeedsCompaction() || compacting.exchange(true)) {
+            return;
+        }
+        // Reads wait for it, the main thread never touches the store
+        std::thread([this] {
+            std::lock_guard<std::mutex> lock(diskMutex);
+            long long before = CurrentTimeMs();
+            std::size_t fileBytes = store.FileBytes();
+            if (store.Compact()) {
+                INFO("Compacted the cover store from {} KB to {} KB in {} ms", fileBytes / 1024, store.FileBytes() / 1024, CurrentTimeMs() - before);
+            } else {
+                WARNING("Failed to compact the cover store");
+            }
+            compacting = false;
+        }).detach();
+    }
+
+    CoverCache& GetCoverCache() {
+        static CoverCache cache;
+        return cache;
+    }
+}  // namespace BetterSongSearch::Util
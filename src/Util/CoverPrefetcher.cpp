@@ -0,0 +1,92 @@
+#include "Util/CoverPrefetcher.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#include "BeatSaverRegionManager.hpp"
+#include "logging.hpp"
+#include "Util/CoverCache.hpp"
+#include "Util/CurrentTimeMs.hpp"
+#include "web-utils/shared/WebUtils.hpp"
+
+namespace BetterSongSearch::Util {
+    void CoverPrefetcher::Prefetch(std::vector<std::string> hashes) {
+        std::lock_guard<std::mutex> lock(mutex);
+        queue.clear();
+        for (auto& hash : hashes) {
+            if (!inFlight.contains(hash)) {
+                queue.push_back(std::move(hash));
+            }
+        }
+
+        while (workers < MAX_CONCURRENT && workers < queue.size()) {
+            workers++;
+            std::thread([this] { Worker(); }).detach();
+        }
+    }
+
+    void CoverPrefetcher::Cancel() {
+        std::lock_guard<std::mutex> lock(mutex);
+        queue.clear();
+    }
+
+    void CoverPrefetcher::Charge(std::size_t bytes) {
+        std::lock_guard<std::mutex> lock(mutex);
+        Refill();
+        tokens -= static_cast<double>(bytes);
+    }
+
+    void CoverPrefetcher::Refill() {
+        long long now = CurrentTimeMs();
+        if (lastRefillMs != 0) {
+            tokens = std::min(BURST_BYTES, tokens + (now - lastRefillMs) * BYTES_PER_SECOND / 1000.0);
+        }
+        lastRefillMs = now;
+    }
+
+    void CoverPrefetcher::Worker() {
+        while (true) {
+            std::string hash;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                if (queue.empty()) {
+                    workers--;
+                    return;
+                }
+                Refill();
+                if (tokens < 0) {
+                    // Over the cap, the queue may be replaced or cancelled while waiting
+                    auto wait = std::chrono::milliseconds(static_cast<long long>(-tokens * 1000.0 / BYTES_PER_SECOND) + 1);
+                    lock.unlock();
+                    std::this_thread::sleep_for(wait);
+                    continue;
+                }
+                hash = std::move(queue.front());
+                queue.pop_front();
+                inFlight.insert(hash);
+            }
+
+            // Started downloads can't be stopped, what they get is still kept for later
+            if (!GetCoverCache().HasCompressed(hash)) {
+                std::string url = fmt::format("{}/{}.jpg", BeatSaverRegionManager::coverDownloadUrl, hash);
+                auto response = WebUtils::Get<WebUtils::DataResponse>(WebUtils::URLOptions(url));
+                if (response.IsSuccessful() && response.responseData.has_value()) {
+                    auto const& bytes = response.responseData.value();
+                    Charge(bytes.size());
+                    GetCoverCache().WriteCompressed(hash, bytes);
+                } else {
+                    DEBUG("Failed to prefetch cover {}", hash);
+                }
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            inFlight.erase(hash);
+        }
+    }
+
+    CoverPrefetcher& GetCoverPrefetcher() {
+        static CoverPrefetcher prefetcher;
+        return prefetcher;
+    }
+}  // namespace BetterSongSearch::Util
@@ -115,6 +115,10 @@ std::string BetterSongSearch::Util::LocalScoreFilterTypeToString(int localScoreF
             return "HidePassed";
         case 2:
             return "OnlyPassed";
+        case 3:
+            return "HidePlayedDiffs";
+        case 4:
+            return "OnlyPlayedDiffs";
         default:
             return "Unknown";
     }
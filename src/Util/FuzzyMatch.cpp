@@ -0,0 +1,73 @@
+#include "Util/FuzzyMatch.hpp"
+
+#include <algorithm>
+
+namespace BetterSongSearch::Util {
+    bool FuzzyPattern::Set(std::string_view pattern) {
+        peq.fill(0);
+        patternLength = 0;
+        lastBit = 0;
+        if (pattern.empty() || pattern.size() > MaxLength) {
+            return false;
+        }
+
+        for (std::size_t i = 0; i < pattern.size(); i++) {
+            peq[static_cast<uint8_t>(pattern[i])] |= 1ull << i;
+        }
+        patternLength = pattern.size();
+        lastBit = 1ull << (patternLength - 1);
+        return true;
+    }
+
+    int FuzzyPattern::Distance(std::string_view text, int maxDistance) const {
+        if (patternLength == 0) {
+            return maxDistance + 1;
+        }
+
+        // Vertical deltas of the current DP column, all +1 at the start (distance to the empty text prefix)
+        uint64_t pv = ~0ull;
+        uint64_t mv = 0;
+        int score = static_cast<int>(patternLength);
+        int best = score;
+
+        for (char c : text) {
+            uint64_t eq = peq[static_cast<uint8_t>(c)];
+            uint64_t xv = eq | mv;
+            uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+            uint64_t ph = mv | ~(xh | pv);
+            uint64_t mh = pv & xh;
+
+            if (ph & lastBit) {
+                score++;
+            } else if (mh & lastBit) {
+                score--;
+            }
+
+            // The match can start anywhere in the text, so the first row stays 0 (no carry in)
+            ph <<= 1;
+            mh <<= 1;
+            pv = mh | ~(xv | ph);
+            mv = ph & xv;
+
+            if (score < best) {
+                best = score;
+                if (best == 0) {
+                    break;
+                }
+            }
+        }
+
+        return std::min(best, maxDistance + 1);
+    }
+
+    int FuzzyMaxDistance(std::size_t wordLength) {
+        if (wordLength < 4) {
+            return 0;
+        }
+        // A transposition costs 2 edits, allow it on longer words only
+        if (wordLength < 6) {
+            return 1;
+        }
+        return 2;
+    }
+}  // namespace BetterSongSearch::Util
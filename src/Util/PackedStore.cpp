@@ -0,0 +1,583 @@
+#include "Util/PackedStore.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <random>
+
+namespace BetterSongSearch::Util {
+    static constexpr uint32_t PACK_MAGIC = 0x4B505342;  // "BSPK"
+    static constexpr uint32_t INDEX_MAGIC = 0x58495342;  // "BSIX"
+    static constexpr uint32_t RECORD_MAGIC = 0x43455242;  // "BREC"
+    static constexpr uint32_t TOMBSTONE_MAGIC = 0x4C445242;  // "BRDL", the key was erased
+    static constexpr uint32_t FORMAT_VERSION = 1;
+    static constexpr uint32_t INITIAL_CAPACITY = 1024;
+    // Smaller packs are not worth rewriting
+    static constexpr uint64_t COMPACTION_MIN_BYTES = 1024 * 1024;
+
+    struct PackHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t packId;  // The index belongs to the pack with the same id
+    };
+
+    struct RecordHeader {
+        uint32_t magic;
+        uint32_t crc;  // Of everything after it, the value included
+        uint32_t length;
+        uint32_t timestamp;
+        char key[PackedStore::KEY_SIZE];
+    };
+
+    struct PackedStore::IndexHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t packId;
+        uint64_t packSize;  // The records before this are in the index
+        uint32_t capacity;  // Power of two
+        uint32_t reserved;
+    };
+
+    struct PackedStore::Slot {
+        char key[KEY_SIZE];
+        uint64_t offset;
+        uint32_t length;
+        uint32_t timestamp;
+        uint32_t state;
+        uint32_t reserved;
+    };
+
+    enum SlotState : uint32_t {
+        SLOT_EMPTY = 0,  // A new file is all zeros
+        SLOT_LIVE = 1,
+        SLOT_ERASED = 2,
+    };
+
+    static void CopyKey(std::string_view key, char* out) {
+        std::memset(out, 0, PackedStore::KEY_SIZE);
+        std::memcpy(out, key.data(), std::min(key.size(), PackedStore::KEY_SIZE));
+    }
+
+    static uint32_t HashKey(char const* key) {
+        // FNV-1a
+        uint32_t hash = 2166136261u;
+        for (std::size_t i = 0; i < PackedStore::KEY_SIZE; i++) {
+            hash = (hash ^ static_cast<uint8_t>(key[i])) * 16777619u;
+        }
+        return hash;
+    }
+
+    static uint32_t RecordCrc(RecordHeader const& record, uint8_t const* value) {
+        uLong crc = crc32(0L, Z_NULL, 0);
+        crc = crc32(crc, reinterpret_cast<Bytef const*>(&record.length), sizeof(RecordHeader) - offsetof(RecordHeader, length));
+        if (record.length > 0) {
+            crc = crc32(crc, value, record.length);
+        }
+        return static_cast<uint32_t>(crc);
+    }
+
+    static uint64_t NewPackId() {
+        std::random_device random;
+        uint64_t id = (static_cast<uint64_t>(random()) << 32) | random();
+        return id ^ std::chrono::steady_clock::now().time_since_epoch().count();
+    }
+
+    static bool ReadAt(int fd, void* out, std::size_t size, uint64_t offset) {
+        auto bytes = static_cast<uint8_t*>(out);
+        while (size > 0) {
+            ssize_t read = pread(fd, bytes, size, static_cast<off_t>(offset));
+            if (read <= 0) {
+                return false;
+            }
+            bytes += read;
+            size -= read;
+            offset += read;
+        }
+        return true;
+    }
+
+    static bool WriteAt(int fd, void const* data, std::size_t size, uint64_t offset) {
+        auto bytes = static_cast<uint8_t const*>(data);
+        while (size > 0) {
+            ssize_t written = pwrite(fd, bytes, size, static_cast<off_t>(offset));
+            if (written <= 0) {
+                return false;
+            }
+            bytes += written;
+            size -= written;
+            offset += written;
+        }
+        return true;
+    }
+
+    PackedStore::~PackedStore() {
+        Close();
+    }
+
+    bool PackedStore::Open(std::string path) {
+        Close();
+        this->path = std::move(path);
+
+        packFd = open((this->path + ".pack").c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (packFd < 0) {
+            return false;
+        }
+        struct stat st {};
+        if (fstat(packFd, &st) != 0) {
+            Close();
+            return false;
+        }
+        packEnd = st.st_size;
+
+        PackHeader packHeader{};
+        if (packEnd < sizeof(PackHeader) || !ReadAt(packFd, &packHeader, sizeof(PackHeader), 0) || packHeader.magic != PACK_MAGIC ||
+            packHeader.version != FORMAT_VERSION) {
+            // New or not ours, start over
+            packHeader = {PACK_MAGIC, FORMAT_VERSION, NewPackId()};
+            if (ftruncate(packFd, 0) != 0 || !WriteAt(packFd, &packHeader, sizeof(PackHeader), 0)) {
+                Close();
+                return false;
+            }
+            packEnd = sizeof(PackHeader);
+        }
+        packId = packHeader.packId;
+
+        if (!MapIndex() && !CreateIndex(INITIAL_CAPACITY, packId, sizeof(PackHeader), {})) {
+            Close();
+            return false;
+        }
+        CountSlots();
+        Replay();
+        CountSlots();
+        return true;
+    }
+
+    void PackedStore::Close() {
+        UnmapIndex();
+        if (packFd >= 0) {
+            close(packFd);
+            packFd = -1;
+        }
+        packId = 0;
+        packEnd = 0;
+        liveCount = 0;
+        usedSlots = 0;
+        liveBytes = 0;
+        deadBytes = 0;
+        recoveredBytes = 0;
+    }
+
+    bool PackedStore::MapIndex() {
+        indexFd = open((path + ".idx").c_str(), O_RDWR | O_CLOEXEC);
+        if (indexFd < 0) {
+            return false;
+        }
+        struct stat st {};
+        if (fstat(indexFd, &st) != 0 || static_cast<std::size_t>(st.st_size) < sizeof(IndexHeader)) {
+            UnmapIndex();
+            return false;
+        }
+        indexMapSize = st.st_size;
+        indexMap = mmap(nullptr, indexMapSize, PROT_READ | PROT_WRITE, MAP_SHARED, indexFd, 0);
+        if (indexMap == MAP_FAILED) {
+            indexMap = nullptr;
+            UnmapIndex();
+            return false;
+        }
+        header = static_cast<IndexHeader*>(indexMap);
+        slots = reinterpret_cast<Slot*>(header + 1);
+
+        // An index of another pack (compaction interrupted) or of a pack that got cut is rebuilt
+        bool valid = header->magic == INDEX_MAGIC && header->version == FORMAT_VERSION && header->packId == packId && header->capacity > 0 &&
+                     (header->capacity & (header->capacity - 1)) == 0 &&
+                     indexMapSize == sizeof(IndexHeader) + static_cast<std::size_t>(header->capacity) * sizeof(Slot) &&
+                     header->packSize >= sizeof(PackHeader) && header->packSize <= packEnd;
+        if (!valid) {
+            UnmapIndex();
+            return false;
+        }
+        return true;
+    }
+
+    void PackedStore::UnmapIndex() {
+        if (indexMap != nullptr) {
+            munmap(indexMap, indexMapSize);
+        }
+        if (indexFd >= 0) {
+            close(indexFd);
+        }
+        indexFd = -1;
+        indexMap = nullptr;
+        indexMapSize = 0;
+        header = nullptr;
+        slots = nullptr;
+    }
+
+    bool PackedStore::CreateIndex(uint32_t capacity, uint64_t packId, uint64_t packSize, std::vector<Slot> const& live) {
+        // Built next to it and renamed, the old index stays valid until the new one is complete
+        std::string indexPath = path + ".idx";
+        std::string tempPath = indexPath + ".tmp";
+        int fd = open(tempPath.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            return false;
+        }
+        std::size_t size = sizeof(IndexHeader) + static_cast<std::size_t>(capacity) * sizeof(Slot);
+        void* map = ftruncate(fd, static_cast<off_t>(size)) == 0 ? mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+        if (map == MAP_FAILED) {
+            close(fd);
+            unlink(tempPath.c_str());
+            return false;
+        }
+
+        UnmapIndex();
+        indexFd = fd;
+        indexMap = map;
+        indexMapSize = size;
+        header = static_cast<IndexHeader*>(map);
+        slots = reinterpret_cast<Slot*>(header + 1);
+        *header = {INDEX_MAGIC, FORMAT_VERSION, packId, packSize, capacity, 0};
+        for (auto const& slot : live) {
+            *FindSlot(slot.key, true) = slot;
+        }
+        usedSlots = live.size();
+
+        return rename(tempPath.c_str(), indexPath.c_str()) == 0;
+    }
+
+    void PackedStore::CountSlots() {
+        liveCount = 0;
+        usedSlots = 0;
+        liveBytes = 0;
+        uint64_t liveRecordBytes = 0;
+        for (uint32_t i = 0; i < header->capacity; i++) {
+            Slot& slot = slots[i];
+            // Points past a pack that was cut, the record is gone
+            if (slot.state == SLOT_LIVE && slot.offset + sizeof(RecordHeader) + slot.length > packEnd) {
+                slot.state = SLOT_ERASED;
+            }
+            if (slot.state != SLOT_EMPTY) {
+                usedSlots++;
+            }
+            if (slot.state == SLOT_LIVE) {
+                liveCount++;
+                liveBytes += slot.length;
+                liveRecordBytes += sizeof(RecordHeader) + slot.length;
+            }
+        }
+        deadBytes = packEnd - sizeof(PackHeader) - std::min<uint64_t>(liveRecordBytes, packEnd - sizeof(PackHeader));
+    }
+
+    PackedStore::Slot* PackedStore::FindSlot(char const* key, bool forInsert) const {
+        uint32_t mask = header->capacity - 1;
+        Slot* firstErased = nullptr;
+        uint32_t pos = HashKey(key) & mask;
+        for (uint32_t i = 0; i <= mask; i++, pos = (pos + 1) & mask) {
+            Slot* slot = &slots[pos];
+            if (slot->state == SLOT_EMPTY) {
+                if (!forInsert) {
+                    return nullptr;
+                }
+                return firstErased != nullptr ? firstErased : slot;
+            }
+            if (slot->state == SLOT_ERASED) {
+                if (firstErased == nullptr) {
+                    firstErased = slot;
+                }
+                continue;
+            }
+            if (std::memcmp(slot->key, key, KEY_SIZE) == 0) {
+                return slot;
+            }
+        }
+        return forInsert ? firstErased : nullptr;
+    }
+
+    bool PackedStore::Grow() {
+        std::vector<Slot> live;
+        live.reserve(liveCount);
+        for (uint32_t i = 0; i < header->capacity; i++) {
+            if (slots[i].state == SLOT_LIVE) {
+                live.push_back(slots[i]);
+            }
+        }
+        return CreateIndex(header->capacity * 2, packId, header->packSize, live);
+    }
+
+    void PackedStore::Apply(uint32_t magic, char const* key, uint64_t offset, uint32_t length, uint32_t timestamp) {
+        uint64_t recordSize = sizeof(RecordHeader) + length;
+        Slot* slot = FindSlot(key, false);
+        if (slot != nullptr) {
+            if (magic == RECORD_MAGIC && slot->offset == offset) {
+                // Replayed, the index got it before the crash
+                return;
+            }
+            deadBytes += sizeof(RecordHeader) + slot->length;
+            liveBytes -= slot->length;
+            if (magic == TOMBSTONE_MAGIC) {
+                slot->state = SLOT_ERASED;
+                liveCount--;
+                deadBytes += recordSize;
+                return;
+            }
+            slot->offset = offset;
+            slot->length = length;
+            slot->timestamp = timestamp;
+            liveBytes += length;
+            return;
+        }
+        if (magic == TOMBSTONE_MAGIC) {
+            deadBytes += recordSize;
+            return;
+        }
+
+        if ((usedSlots + 1) * 4 > static_cast<std::size_t>(header->capacity) * 3) {
+            Grow();
+        }
+        slot = FindSlot(key, true);
+        if (slot == nullptr) {
+            // Full and couldn't grow, the value can't be found so it's dead
+            deadBytes += recordSize;
+            return;
+        }
+        if (slot->state == SLOT_EMPTY) {
+            usedSlots++;
+        }
+        std::memcpy(slot->key, key, KEY_SIZE);
+        slot->offset = offset;
+        slot->length = length;
+        slot->timestamp = timestamp;
+        slot->state = SLOT_LIVE;
+        liveCount++;
+        liveBytes += length;
+    }
+
+    void PackedStore::Replay() {
+        uint64_t pos = header->packSize;
+        std::vector<uint8_t> value;
+        while (pos + sizeof(RecordHeader) <= packEnd) {
+            RecordHeader record{};
+            if (!ReadAt(packFd, &record, sizeof(RecordHeader), pos)) {
+                break;
+            }
+            bool isTombstone = record.magic == TOMBSTONE_MAGIC;
+            if ((record.magic != RECORD_MAGIC && !isTombstone) || (isTombstone && record.length != 0) ||
+                record.length > packEnd - pos - sizeof(RecordHeader)) {
+                break;
+            }
+            value.resize(record.length);
+            if (record.length > 0 && !ReadAt(packFd, value.data(), record.length, pos + sizeof(RecordHeader))) {
+                break;
+            }
+            if (RecordCrc(record, value.data()) != record.crc) {
+                break;
+            }
+            Apply(record.magic, record.key, pos, record.length, record.timestamp);
+            pos += sizeof(RecordHeader) + record.length;
+        }
+
+        // The rest is a write that didn't finish, the next append goes where it started
+        if (pos < packEnd) {
+            recoveredBytes = packEnd - pos;
+            ftruncate(packFd, static_cast<off_t>(pos));
+            packEnd = pos;
+        }
+        header->packSize = packEnd;
+    }
+
+    bool PackedStore::AppendRecord(uint32_t magic, char const* key, std::span<uint8_t const> value, uint32_t timestamp, uint64_t& offset) {
+        RecordHeader record{magic, 0, static_cast<uint32_t>(value.size()), timestamp, {}};
+        std::memcpy(record.key, key, KEY_SIZE);
+        record.crc = RecordCrc(record, value.data());
+
+        std::vector<uint8_t> buffer(sizeof(RecordHeader) + value.size());
+        std::memcpy(buffer.data(), &record, sizeof(RecordHeader));
+        std::copy(value.begin(), value.end(), buffer.begin() + sizeof(RecordHeader));
+        if (!WriteAt(packFd, buffer.data(), buffer.size(), packEnd)) {
+            // Half a record would hide everything appended after it from a replay
+            ftruncate(packFd, static_cast<off_t>(packEnd));
+            return false;
+        }
+        offset = packEnd;
+        packEnd += buffer.size();
+        return true;
+    }
+
+    std::optional<std::vector<uint8_t>> PackedStore::Read(std::string_view key) {
+        if (!IsOpen()) {
+            return std::nullopt;
+        }
+        char packedKey[KEY_SIZE];
+        CopyKey(key, packedKey);
+        Slot* slot = FindSlot(packedKey, false);
+        if (slot == nullptr) {
+            return std::nullopt;
+        }
+
+        RecordHeader record{};
+        std::vector<uint8_t> value(slot->length);
+        bool valid = ReadAt(packFd, &record, sizeof(RecordHeader), slot->offset) && record.magic == RECORD_MAGIC && record.length == slot->length &&
+                     std::memcmp(record.key, packedKey, KEY_SIZE) == 0 &&
+                     (record.length == 0 || ReadAt(packFd, value.data(), record.length, slot->offset + sizeof(RecordHeader))) &&
+                     RecordCrc(record, value.data()) == record.crc;
+        if (!valid) {
+            // Lost in a crash after the index was written, only the index knew about it
+            deadBytes += sizeof(RecordHeader) + slot->length;
+            liveBytes -= slot->length;
+            liveCount--;
+            slot->state = SLOT_ERASED;
+            return std::nullopt;
+        }
+        return value;
+    }
+
+    bool PackedStore::Contains(std::string_view key) const {
+        if (!IsOpen()) {
+            return false;
+        }
+        char packedKey[KEY_SIZE];
+        CopyKey(key, packedKey);
+        return FindSlot(packedKey, false) != nullptr;
+    }
+
+    bool PackedStore::Write(std::string_view key, std::span<uint8_t const> value, uint32_t timestamp) {
+        if (!IsOpen() || value.size() > UINT32_MAX - sizeof(RecordHeader)) {
+            return false;
+        }
+        char packedKey[KEY_SIZE];
+        CopyKey(key, packedKey);
+        uint64_t offset = 0;
+        if (!AppendRecord(RECORD_MAGIC, packedKey, value, timestamp, offset)) {
+            return false;
+        }
+        Apply(RECORD_MAGIC, packedKey, offset, static_cast<uint32_t>(value.size()), timestamp);
+        header->packSize = packEnd;
+        return true;
+    }
+
+    void PackedStore::Erase(std::string_view key) {
+        if (!IsOpen()) {
+            return;
+        }
+        char packedKey[KEY_SIZE];
+        CopyKey(key, packedKey);
+        if (FindSlot(packedKey, false) == nullptr) {
+            return;
+        }
+        // Without the tombstone a rebuilt index would bring the value back
+        uint64_t offset = 0;
+        if (!AppendRecord(TOMBSTONE_MAGIC, packedKey, {}, 0, offset)) {
+            return;
+        }
+        Apply(TOMBSTONE_MAGIC, packedKey, offset, 0, 0);
+        header->packSize = packEnd;
+    }
+
+    void PackedStore::Touch(std::string_view key, uint32_t timestamp) {
+        if (!IsOpen()) {
+            return;
+        }
+        char packedKey[KEY_SIZE];
+        CopyKey(key, packedKey);
+        if (Slot* slot = FindSlot(packedKey, false)) {
+            slot->timestamp = timestamp;
+        }
+    }
+
+    std::vector<PackedStore::Entry> PackedStore::Entries() const {
+        std::vector<Entry> entries;
+        if (!IsOpen()) {
+            return entries;
+        }
+        entries.reserve(liveCount);
+        for (uint32_t i = 0; i < header->capacity; i++) {
+            Slot const& slot = slots[i];
+            if (slot.state == SLOT_LIVE) {
+                entries.push_back({std::string(slot.key, strnlen(slot.key, KEY_SIZE)), slot.length, slot.timestamp});
+            }
+        }
+        return entries;
+    }
+
+    bool PackedStore::NeedsCompaction() const {
+        return IsOpen() && packEnd >= COMPACTION_MIN_BYTES && deadBytes * 2 > packEnd;
+    }
+
+    bool PackedStore::Compact() {
+        if (!IsOpen()) {
+            return false;
+        }
+        std::string packPath = path + ".pack";
+        std::string tempPath = packPath + ".tmp";
+        int fd = open(tempPath.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            return false;
+        }
+
+        PackHeader packHeader{PACK_MAGIC, FORMAT_VERSION, NewPackId()};
+        uint64_t end = sizeof(PackHeader);
+        bool ok = WriteAt(fd, &packHeader, sizeof(PackHeader), 0);
+        std::vector<Slot> live;
+        live.reserve(liveCount);
+        std::vector<uint8_t> buffer;
+        for (uint32_t i = 0; ok && i < header->capacity; i++) {
+            Slot const& slot = slots[i];
+            if (slot.state != SLOT_LIVE) {
+                continue;
+            }
+            std::size_t size = sizeof(RecordHeader) + slot.length;
+            buffer.resize(size);
+            RecordHeader record{};
+            if (!ReadAt(packFd, buffer.data(), size, slot.offset)) {
+                continue;
+            }
+            // Damaged records are left behind
+            std::memcpy(&record, buffer.data(), sizeof(RecordHeader));
+            uint8_t const* value = buffer.data() + sizeof(RecordHeader);
+            if (record.magic != RECORD_MAGIC || record.length != slot.length || std::memcmp(record.key, slot.key, KEY_SIZE) != 0 ||
+                RecordCrc(record, value) != record.crc) {
+                continue;
+            }
+
+            // Touched timestamps go into the record, so they survive an index rebuild
+            record.timestamp = slot.timestamp;
+            record.crc = RecordCrc(record, value);
+            std::memcpy(buffer.data(), &record, sizeof(RecordHeader));
+            ok = WriteAt(fd, buffer.data(), size, end);
+
+            Slot moved = slot;
+            moved.offset = end;
+            live.push_back(moved);
+            end += size;
+        }
+
+        ok = ok && fsync(fd) == 0 && rename(tempPath.c_str(), packPath.c_str()) == 0;
+        if (!ok) {
+            close(fd);
+            unlink(tempPath.c_str());
+            return false;
+        }
+        close(packFd);
+        packFd = fd;
+        packId = packHeader.packId;
+        packEnd = end;
+
+        // Until the new index is renamed in the old one has the old pack id and gets rebuilt from the new pack
+        uint32_t capacity = INITIAL_CAPACITY;
+        while (live.size() * 4 > static_cast<std::size_t>(capacity) * 3) {
+            capacity *= 2;
+        }
+        if (!CreateIndex(capacity, packId, packEnd, live)) {
+            // The mapped index belongs to the old pack, reopening rebuilds it
+            return Open(path);
+        }
+        CountSlots();
+        return true;
+    }
+}  // namespace BetterSongSearch::Util
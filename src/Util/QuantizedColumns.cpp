@@ -0,0 +1,33 @@
+#include "Util/QuantizedColumns.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace BetterSongSearch::Util {
+    // Bounds past the representable range are clamped to this, far enough that they never make a value an edge
+    static constexpr double BOUND_LIMIT = 1 << 20;
+
+    void QuantizedColumns::Push(float njs, float nps, float starsSS, float starsBL) {
+        entries.push_back({
+            Quantize(njs, NJS_SCALE),
+            nps < 0 ? NO_VALUE : Quantize(nps, NPS_SCALE),
+            Quantize(starsSS, STARS_SCALE),
+            Quantize(starsBL, STARS_SCALE),
+        });
+    }
+
+    uint16_t QuantizedColumns::Quantize(float value, float scale) {
+        double scaled = std::floor(static_cast<double>(value) * scale);
+        if (!(scaled > 0)) {
+            return 0;
+        }
+        return static_cast<uint16_t>(std::min(scaled, static_cast<double>(NO_VALUE - 1)));
+    }
+
+    QuantizedColumns::Bounds QuantizedColumns::MakeBounds(float scale, float min, float max) {
+        auto bound = [scale](float value) {
+            return static_cast<int32_t>(std::clamp(std::floor(static_cast<double>(value) * scale), -BOUND_LIMIT, BOUND_LIMIT));
+        };
+        return {bound(min), bound(max)};
+    }
+}  // namespace BetterSongSearch::Util
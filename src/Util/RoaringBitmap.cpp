@@ -0,0 +1,278 @@
+#include "Util/RoaringBitmap.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <iterator>
+
+namespace BetterSongSearch::Util {
+    static constexpr std::size_t CHUNK_WORDS = 65536 / 64;
+
+    template <typename Chunk>
+    static void ToBits(Chunk const& chunk, std::vector<uint64_t>& words) {
+        if (chunk.IsBitmap()) {
+            words = chunk.bits;
+            return;
+        }
+        words.assign(CHUNK_WORDS, 0);
+        for (uint16_t low : chunk.array) {
+            words[low / 64] |= 1ull << (low % 64);
+        }
+    }
+
+    // Stores words in the chunk, as an array if it got sparse enough
+    template <typename Chunk>
+    static void FromBits(Chunk& chunk, std::vector<uint64_t>&& words) {
+        uint32_t cardinality = 0;
+        for (uint64_t word : words) {
+            cardinality += std::popcount(word);
+        }
+        chunk.cardinality = cardinality;
+        chunk.array.clear();
+        if (cardinality > RoaringBitmap::ARRAY_MAX_SIZE) {
+            chunk.bits = std::move(words);
+            return;
+        }
+        chunk.bits.clear();
+        chunk.bits.shrink_to_fit();
+        chunk.array.reserve(cardinality);
+        for (std::size_t w = 0; w < words.size(); w++) {
+            uint64_t word = words[w];
+            while (word != 0) {
+                chunk.array.push_back(static_cast<uint16_t>(w * 64 + std::countr_zero(word)));
+                word &= word - 1;
+            }
+        }
+    }
+
+    void RoaringBitmap::Add(uint32_t value) {
+        uint16_t key = value >> 16;
+        uint16_t low = value & 0xFFFF;
+
+        auto it = chunks.end();
+        if (chunks.empty() || chunks.back().key < key) {
+            it = chunks.insert(chunks.end(), Chunk{key});
+        } else if (chunks.back().key == key) {
+            it = chunks.end() - 1;
+        } else {
+            it = std::lower_bound(chunks.begin(), chunks.end(), key, [](Chunk const& chunk, uint16_t key) {
+                return chunk.key < key;
+            });
+            if (it == chunks.end() || it->key != key) {
+                it = chunks.insert(it, Chunk{key});
+            }
+        }
+
+        auto& chunk = *it;
+        if (chunk.IsBitmap()) {
+            uint64_t& word = chunk.bits[low / 64];
+            uint64_t mask = 1ull << (low % 64);
+            if ((word & mask) == 0) {
+                word |= mask;
+                chunk.cardinality++;
+            }
+            return;
+        }
+
+        if (chunk.array.empty() || chunk.array.back() < low) {
+            chunk.array.push_back(low);
+        } else {
+            auto pos = std::lower_bound(chunk.array.begin(), chunk.array.end(), low);
+            if (*pos == low) {
+                return;
+            }
+            chunk.array.insert(pos, low);
+        }
+        chunk.cardinality++;
+
+        if (chunk.array.size() > ARRAY_MAX_SIZE) {
+            std::vector<uint64_t> words;
+            ToBits(chunk, words);
+            FromBits(chunk, std::move(words));
+        }
+    }
+
+    bool RoaringBitmap::Contains(uint32_t value) const {
+        uint16_t key = value >> 16;
+        uint16_t low = value & 0xFFFF;
+        auto it = std::lower_bound(chunks.begin(), chunks.end(), key, [](Chunk const& chunk, uint16_t key) {
+            return chunk.key < key;
+        });
+        if (it == chunks.end() || it->key != key) {
+            return false;
+        }
+        if (it->IsBitmap()) {
+            return (it->bits[low / 64] >> (low % 64)) & 1;
+        }
+        return std::binary_search(it->array.begin(), it->array.end(), low);
+    }
+
+    void RoaringBitmap::Clear() {
+        chunks.clear();
+    }
+
+    RoaringBitmap RoaringBitmap::FromSorted(std::span<uint32_t const> values) {
+        RoaringBitmap result;
+        for (uint32_t value : values) {
+            result.Add(value);
+        }
+        return result;
+    }
+
+    RoaringBitmap& RoaringBitmap::operator&=(RoaringBitmap const& other) {
+        std::vector<Chunk> result;
+        std::vector<uint64_t> words;
+        auto a = chunks.begin();
+        auto b = other.chunks.begin();
+        while (a != chunks.end() && b != other.chunks.end()) {
+            if (a->key < b->key) {
+                ++a;
+            } else if (b->key < a->key) {
+                ++b;
+            } else {
+                Chunk chunk{a->key};
+                if (!a->IsBitmap() && !b->IsBitmap()) {
+                    std::set_intersection(a->array.begin(), a->array.end(), b->array.begin(), b->array.end(), std::back_inserter(chunk.array));
+                    chunk.cardinality = chunk.array.size();
+                } else if (!a->IsBitmap() || !b->IsBitmap()) {
+                    // Only the array values can be in the result
+                    auto const& array = a->IsBitmap() ? b->array : a->array;
+                    auto const& bits = a->IsBitmap() ? a->bits : b->bits;
+                    for (uint16_t low : array) {
+                        if ((bits[low / 64] >> (low % 64)) & 1) {
+                            chunk.array.push_back(low);
+                        }
+                    }
+                    chunk.cardinality = chunk.array.size();
+                } else {
+                    words = a->bits;
+                    for (std::size_t w = 0; w < CHUNK_WORDS; w++) {
+                        words[w] &= b->bits[w];
+                    }
+                    FromBits(chunk, std::move(words));
+                }
+                if (chunk.cardinality > 0) {
+                    result.push_back(std::move(chunk));
+                }
+                ++a;
+                ++b;
+            }
+        }
+        chunks = std::move(result);
+        return *this;
+    }
+
+    RoaringBitmap& RoaringBitmap::operator|=(RoaringBitmap const& other) {
+        std::vector<Chunk> result;
+        std::vector<uint64_t> words;
+        std::vector<uint64_t> otherWords;
+        auto a = chunks.begin();
+        auto b = other.chunks.begin();
+        while (a != chunks.end() || b != other.chunks.end()) {
+            if (b == other.chunks.end() || (a != chunks.end() && a->key < b->key)) {
+                result.push_back(std::move(*a));
+                ++a;
+            } else if (a == chunks.end() || b->key < a->key) {
+                result.push_back(*b);
+                ++b;
+            } else {
+                Chunk chunk{a->key};
+                if (!a->IsBitmap() && !b->IsBitmap() && a->array.size() + b->array.size() <= ARRAY_MAX_SIZE) {
+                    std::set_union(a->array.begin(), a->array.end(), b->array.begin(), b->array.end(), std::back_inserter(chunk.array));
+                    chunk.cardinality = chunk.array.size();
+                } else {
+                    ToBits(*a, words);
+                    ToBits(*b, otherWords);
+                    for (std::size_t w = 0; w < CHUNK_WORDS; w++) {
+                        words[w] |= otherWords[w];
+                    }
+                    FromBits(chunk, std::move(words));
+                }
+                result.push_back(std::move(chunk));
+                ++a;
+                ++b;
+            }
+        }
+        chunks = std::move(result);
+        return *this;
+    }
+
+    RoaringBitmap& RoaringBitmap::operator-=(RoaringBitmap const& other) {
+        std::vector<Chunk> result;
+        std::vector<uint64_t> words;
+        auto b = other.chunks.begin();
+        for (auto& a : chunks) {
+            while (b != other.chunks.end() && b->key < a.key) {
+                ++b;
+            }
+            if (b == other.chunks.end() || b->key != a.key) {
+                result.push_back(std::move(a));
+                continue;
+            }
+
+            Chunk chunk{a.key};
+            if (!a.IsBitmap()) {
+                // Result is a subset of the array
+                for (uint16_t low : a.array) {
+                    bool removed = b->IsBitmap() ? ((b->bits[low / 64] >> (low % 64)) & 1) : std::binary_search(b->array.begin(), b->array.end(), low);
+                    if (!removed) {
+                        chunk.array.push_back(low);
+                    }
+                }
+                chunk.cardinality = chunk.array.size();
+            } else {
+                words = std::move(a.bits);
+                if (b->IsBitmap()) {
+                    for (std::size_t w = 0; w < CHUNK_WORDS; w++) {
+                        words[w] &= ~b->bits[w];
+                    }
+                } else {
+                    for (uint16_t low : b->array) {
+                        words[low / 64] &= ~(1ull << (low % 64));
+                    }
+                }
+                FromBits(chunk, std::move(words));
+            }
+            if (chunk.cardinality > 0) {
+                result.push_back(std::move(chunk));
+            }
+        }
+        chunks = std::move(result);
+        return *this;
+    }
+
+    void RoaringBitmap::ToVector(std::vector<uint32_t>& out) const {
+        out.reserve(out.size() + Cardinality());
+        for (auto const& chunk : chunks) {
+            uint32_t high = static_cast<uint32_t>(chunk.key) << 16;
+            if (!chunk.IsBitmap()) {
+                for (uint16_t low : chunk.array) {
+                    out.push_back(high | low);
+                }
+                continue;
+            }
+            for (std::size_t w = 0; w < CHUNK_WORDS; w++) {
+                uint64_t word = chunk.bits[w];
+                while (word != 0) {
+                    out.push_back(high | static_cast<uint32_t>(w * 64 + std::countr_zero(word)));
+                    word &= word - 1;
+                }
+            }
+        }
+    }
+
+    std::size_t RoaringBitmap::Cardinality() const {
+        std::size_t total = 0;
+        for (auto const& chunk : chunks) {
+            total += chunk.cardinality;
+        }
+        return total;
+    }
+
+    std::size_t RoaringBitmap::bytes() const {
+        std::size_t total = chunks.capacity() * sizeof(Chunk);
+        for (auto const& chunk : chunks) {
+            total += chunk.array.capacity() * sizeof(uint16_t) + chunk.bits.capacity() * sizeof(uint64_t);
+        }
+        return total;
+    }
+}  // namespace BetterSongSearch::Util
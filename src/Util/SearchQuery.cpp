@@ -0,0 +1,31 @@
+#include "Util/SearchQuery.hpp"
+
+#include <algorithm>
+
+#include "Util/SongIndex.hpp"
+#include "Util/TextNormalize.hpp"
+
+namespace BetterSongSearch::Util {
+    SearchQuery::SearchQuery(std::string_view search, ArtistTable const& artists) {
+        NormalizeSearchText(search, buffer);
+        // Trim so the whole query can be compared to names
+        buffer.erase(0, std::min(buffer.find_first_not_of(' '), buffer.size()));
+        buffer.erase(buffer.find_last_not_of(' ') + 1);
+
+        std::string_view rest = buffer;
+        while (!rest.empty()) {
+            auto start = rest.find_first_not_of(' ');
+            if (start == std::string_view::npos) {
+                break;
+            }
+            rest.remove_prefix(start);
+            auto end = rest.find(' ');
+            auto& token = _tokens.emplace_back();
+            token.text = rest.substr(0, end);
+            token.maybeKey = ParseSongKey(token.text, token.keyValue);
+            token.artistId = artists.Find(token.text);
+            token.isKnownAuthor = token.artistId != ArtistTable::npos;
+            rest.remove_prefix(token.text.size());
+        }
+    }
+}  // namespace BetterSongSearch::Util
@@ -0,0 +1,170 @@
+#include "Util/SongIndex.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+namespace BetterSongSearch::Util {
+    static inline int HexValue(uint32_t c) {
+        if (c >= '0' && c <= '9') {
+            return c - '0';
+        }
+        c |= 0x20;  // lowercase
+        if (c >= 'a' && c <= 'f') {
+            return c - 'a' + 10;
+        }
+        return -1;
+    }
+
+    template <typename Char>
+    static bool DecodeHashImpl(std::basic_string_view<Char> hex, SongHash& out) {
+        if (hex.size() != out.size() * 2) {
+            return false;
+        }
+        for (std::size_t i = 0; i < out.size(); i++) {
+            int hi = HexValue(static_cast<uint32_t>(hex[i * 2]));
+            int lo = HexValue(static_cast<uint32_t>(hex[i * 2 + 1]));
+            if (hi < 0 || lo < 0) {
+                return false;
+            }
+            out[i] = static_cast<uint8_t>((hi << 4) | lo);
+        }
+        return true;
+    }
+
+    bool DecodeHash(std::string_view hex, SongHash& out) {
+        return DecodeHashImpl(hex, out);
+    }
+
+    bool DecodeHash(std::u16string_view hex, SongHash& out) {
+        return DecodeHashImpl(hex, out);
+    }
+
+    static inline uint32_t SlotHash(SongHash const& hash) {
+        uint32_t h;
+        std::memcpy(&h, hash.data(), sizeof(h));
+        return h;
+    }
+
+    void SongHashIndex::Build(std::vector<SongHash> hashes) {
+        this->hashes = std::move(hashes);
+
+        // Keep load factor <= 0.5 so probe chains stay short
+        std::size_t capacity = std::bit_ceil(std::max<std::size_t>(16, this->hashes.size() * 2));
+        mask = static_cast<uint32_t>(capacity - 1);
+        slots.assign(capacity, 0);
+
+        for (uint32_t i = 0; i < this->hashes.size(); i++) {
+            uint32_t slot = SlotHash(this->hashes[i]) & mask;
+            while (slots[slot] != 0) {
+                // Duplicate hash, keep the first song
+                if (this->hashes[slots[slot] - 1] == this->hashes[i]) {
+                    break;
+                }
+                slot = (slot + 1) & mask;
+            }
+            if (slots[slot] == 0) {
+                slots[slot] = i + 1;
+            }
+        }
+    }
+
+    void SongHashIndex::Clear() {
+        slots.clear();
+        hashes.clear();
+        mask = 0;
+    }
+
+    uint32_t SongHashIndex::Find(SongHash const& hash) const {
+        if (slots.empty()) {
+            return npos;
+        }
+        uint32_t slot = SlotHash(hash) & mask;
+        while (slots[slot] != 0) {
+            uint32_t songIndex = slots[slot] - 1;
+            if (hashes[songIndex] == hash) {
+                return songIndex;
+            }
+            slot = (slot + 1) & mask;
+        }
+        return npos;
+    }
+
+    uint32_t SongHashIndex::Find(std::string_view hex) const {
+        SongHash hash;
+        if (!DecodeHash(hex, hash)) {
+            return npos;
+        }
+        return Find(hash);
+    }
+
+    void MapIdIndex::Build(std::vector<uint32_t> const& mapIds) {
+        entries.clear();
+        entries.reserve(mapIds.size());
+        for (uint32_t i = 0; i < mapIds.size(); i++) {
+            entries.emplace_back(mapIds[i], i);
+        }
+        std::sort(entries.begin(), entries.end());
+    }
+
+    void MapIdIndex::Clear() {
+        entries.clear();
+    }
+
+    uint32_t MapIdIndex::Find(uint32_t mapId) const {
+        auto it = std::lower_bound(entries.begin(), entries.end(), std::make_pair(mapId, 0u));
+        if (it == entries.end() || it->first != mapId) {
+            return npos;
+        }
+        return it->second;
+    }
+
+    void MapIdIndex::FindByKeyPrefix(std::string_view prefix, std::vector<uint32_t>& out, std::size_t limit) const {
+        uint32_t prefixValue = 0;
+        if (!ParseSongKey(prefix, prefixValue)) {
+            return;
+        }
+
+        // Keys have no leading zeros, so a longer prefix starting with 0 matches nothing
+        if (prefix.size() > 1 && prefix.front() == '0') {
+            return;
+        }
+
+        // A key of length L starting with the prefix is in [prefix << 4*(L-n), (prefix + 1) << 4*(L-n)),
+        // clamped to the keys that are exactly L digits long
+        for (std::size_t length = prefix.size(); length <= 8 && out.size() < limit; length++) {
+            uint64_t shift = 4 * (length - prefix.size());
+            uint64_t lengthFrom = length == 1 ? 0 : 1ull << (4 * (length - 1));
+            uint64_t lengthTo = 1ull << (4 * length);
+            uint64_t from = std::max(static_cast<uint64_t>(prefixValue) << shift, lengthFrom);
+            uint64_t to = std::min(static_cast<uint64_t>(prefixValue + 1ull) << shift, lengthTo);
+            if (from > UINT32_MAX) {
+                break;
+            }
+            if (from >= to) {
+                continue;
+            }
+
+            auto it = std::lower_bound(entries.begin(), entries.end(), std::make_pair(static_cast<uint32_t>(from), 0u));
+            for (; it != entries.end() && it->first < to && out.size() < limit; ++it) {
+                out.push_back(it->second);
+            }
+        }
+    }
+
+    bool ParseSongKey(std::string_view key, uint32_t& out) {
+        if (key.empty() || key.size() > 8) {
+            return false;
+        }
+        uint32_t value = 0;
+        for (char c : key) {
+            int v = HexValue(static_cast<uint8_t>(c));
+            if (v < 0) {
+                return false;
+            }
+            value = (value << 4) | v;
+        }
+        out = value;
+        return true;
+    }
+}  // namespace BetterSongSearch::Util
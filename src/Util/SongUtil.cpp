@@ -1,5 +1,8 @@
 #include "Util/SongUtil.hpp"
 
+#include <algorithm>
+#include <array>
+
 #include "bsml/shared/BSML-Lite/Creation/Image.hpp"
 #include "DataHolder.hpp"
 #include "logging.hpp"
@@ -57,23 +60,20 @@ namespace BetterSongSearch::Util {
         }
     }
 
-    // Gets preferred leaderboard for a song difficulty
-    SongDetailsCache::RankedStates GetTargetedRankLeaderboardService(SongDetailsCache::SongDifficulty const* diff) {
-        auto& rStates = diff->song().rankedStates;
-
-        auto& filterOptions = dataHolder.filterOptionsCache;
-
+    SongDetailsCache::RankedStates TargetedRankLeaderboardService(
+        SongDetailsCache::RankedStates rStates, FilterTypes::RankedFilter rankedFilter, FilterTypes::PreferredLeaderBoard preferredLeaderboard
+    ) {
         // If song is scoresaber ranked
         if (hasFlags(rStates, RankedStates::ScoresaberRanked) &&
             // And Not Filtering by BeatLeader ranked
-            static_cast<FilterTypes::RankedFilter>(dataHolder.filterOptionsCache.rankedType) != FilterTypes::RankedFilter::BeatLeaderRanked &&
+            rankedFilter != FilterTypes::RankedFilter::BeatLeaderRanked &&
             (
                 // Beatleader is not preferred leaderboard
-                dataHolder.preferredLeaderboard != FilterTypes::PreferredLeaderBoard::BeatLeader ||
+                preferredLeaderboard != FilterTypes::PreferredLeaderBoard::BeatLeader ||
                 // Song has no BeatLeader rank
                 !hasFlags(rStates, RankedStates::BeatleaderRanked) ||
                 // Filtering by SS ranked
-                static_cast<FilterTypes::RankedFilter>(dataHolder.filterOptionsCache.rankedType) == FilterTypes::RankedFilter::ScoreSaberRanked
+                rankedFilter == FilterTypes::RankedFilter::ScoreSaberRanked
             )) {
             return SongDetailsCache::RankedStates::ScoresaberRanked;
         }
@@ -86,6 +86,13 @@ namespace BetterSongSearch::Util {
         return SongDetailsCache::RankedStates::Unranked;
     }
 
+    // Gets preferred leaderboard for a song difficulty
+    SongDetailsCache::RankedStates GetTargetedRankLeaderboardService(SongDetailsCache::SongDifficulty const* diff) {
+        return TargetedRankLeaderboardService(
+            diff->song().rankedStates, static_cast<FilterTypes::RankedFilter>(dataHolder.filterOptionsCache.rankedType), dataHolder.preferredLeaderboard
+        );
+    }
+
     float getStars(SongDetailsCache::SongDifficulty const* diff, SongDetailsCache::RankedStates state) {
         if (state == SongDetailsCache::RankedStates::ScoresaberRanked && diff->starsSS > 0) {
             return diff->starsSS;
@@ -97,12 +104,17 @@ namespace BetterSongSearch::Util {
     }
 
     float getStars(SongDetailsCache::SongDifficulty const* diff) {
+        // Column of the current leaderboard choice, so the choice isn't made again for every difficulty
+        if (auto column = dataHolder.GetStarColumn()) {
+            if (auto stars = column->Get(diff, &diff->song())) {
+                return *stars;
+            }
+        }
         return getStars(diff, GetTargetedRankLeaderboardService(diff));
     }
 
     bool MeetsFilter(SongDetailsCache::Song const* song) {
         auto& filterOptions = dataHolder.filterOptionsCache;
-        std::string songHash = song->hash();
 
         if (filterOptions.onlyCuratedMaps) {
             if (!hasFlags(song->uploadFlags, SongDetailsCache::UploadFlags::Curated)) {
@@ -160,9 +172,9 @@ namespace BetterSongSearch::Util {
 
         // Skip if not needed
         auto localScoreType = static_cast<FilterTypes::LocalScoreFilter>(filterOptions.localScoreType);
-        if (localScoreType != FilterTypes::LocalScoreFilter::All) {
+        if (localScoreType != FilterTypes::LocalScoreFilter::All && localScoreType != FilterTypes::LocalScoreFilter::HidePlayedDiffs) {
             bool hasLocalScore = false;
-            if (dataHolder.SongHasScore(songHash)) {
+            if (dataHolder.SongHasScore(song)) {
                 hasLocalScore = true;
             }
             if (hasLocalScore) {
@@ -170,7 +182,8 @@ namespace BetterSongSearch::Util {
                     return false;
                 }
             } else {
-                if (localScoreType == FilterTypes::LocalScoreFilter::OnlyPassed) {
+                // Songs without any score can't have played difficulties either
+                if (localScoreType == FilterTypes::LocalScoreFilter::OnlyPassed || localScoreType == FilterTypes::LocalScoreFilter::OnlyPlayedDiffs) {
                     return false;
                 }
             }
@@ -183,18 +196,10 @@ namespace BetterSongSearch::Util {
             }
         }
 
-        bool passesDiffFilter = true;
-
-        for (auto const& diff : *song) {
-            if (DifficultyCheck(&diff, song)) {
-                passesDiffFilter = true;
-                break;
-            } else {
-                passesDiffFilter = false;
-            }
-        }
-
-        if (!passesDiffFilter) {
+        // All difficulties are checked so sorting and the cells can reuse the result
+        auto diffResult = EvaluateDifficulties(song);
+        dataHolder.SetDiffFilterResult(song->index, diffResult);
+        if (!diffResult.anyPasses) {
             return false;
         }
 
@@ -207,7 +212,7 @@ namespace BetterSongSearch::Util {
 
         // This is the most heavy filter, check it last
         if (static_cast<FilterTypes::DownloadFilter>(filterOptions.downloadType) != FilterTypes::DownloadFilter::All) {
-            bool downloaded = SongCore::API::Loading::GetLevelByHash(songHash) != nullptr;
+            bool downloaded = SongCore::API::Loading::GetLevelByHash(song->hash()) != nullptr;
             if (downloaded) {
                 if (static_cast<FilterTypes::DownloadFilter>(filterOptions.downloadType) == FilterTypes::DownloadFilter::HideDownloaded) {
                     return false;
@@ -222,7 +227,28 @@ namespace BetterSongSearch::Util {
         return true;
     }
 
+    bool MeetsModRequirement(SongDetailsCache::SongDifficulty const* diff, FilterTypes::Requirement requirement) {
+        switch (requirement) {
+            case FilterTypes::Requirement::Chroma:
+                return hasFlags(diff->mods, MapMods::Chroma);
+            case FilterTypes::Requirement::Cinema:
+                return hasFlags(diff->mods, MapMods::Cinema);
+            case FilterTypes::Requirement::MappingExtensions:
+                return hasFlags(diff->mods, MapMods::MappingExtensions);
+            case FilterTypes::Requirement::NoodleExtensions:
+                return hasFlags(diff->mods, MapMods::NoodleExtensions);
+            case FilterTypes::Requirement::None:
+                return (diff->mods & (MapMods::NE | MapMods::ME)) == MapMods::None;
+            default:
+                return true;
+        }
+    }
+
     bool DifficultyCheck(SongDetailsCache::SongDifficulty const* diff, SongDetailsCache::Song const* song) {
+        return DifficultyCheck(diff, song, GetTargetedRankLeaderboardService(diff));
+    }
+
+    bool DifficultyCheck(SongDetailsCache::SongDifficulty const* diff, SongDetailsCache::Song const* song, SongDetailsCache::RankedStates leaderboard) {
         auto const& currentFilter = dataHolder.filterOptionsCache;
 
         // if all filters are default, skip
@@ -237,16 +263,48 @@ namespace BetterSongSearch::Util {
             }
         }
 
+        // The quantized columns decide most bounds without reading the difficulty, exact values are only needed near the bounds
+        uint32_t diffIndex = dataHolder.GlobalDiffIndex(diff, song);
+        QuantizedColumns::Entry const* quantized = diffIndex < dataHolder.quantizedColumns.size() ? &dataHolder.quantizedColumns.at(diffIndex) : nullptr;
+
         // Min and max stars
-        if (currentFilter.maxStars != STAR_FILTER_MAX) {
-            if (getStars(diff) > currentFilter.maxStars) {
-                return false;
+        bool checkMaxStars = currentFilter.maxStars != STAR_FILTER_MAX;
+        bool checkMinStars = currentFilter.minStars > 0;
+        if (checkMaxStars || checkMinStars) {
+            auto starsCheck = BoundCheck::Edge;
+            if (quantized) {
+                uint16_t stars = leaderboard == RankedStates::ScoresaberRanked   ? quantized->starsSS
+                                 : leaderboard == RankedStates::BeatleaderRanked ? quantized->starsBL
+                                                                                 : 0;
+                starsCheck = QuantizedColumns::Check(stars, currentFilter.starsBoundsPreprocessed);
             }
-        }
-        if (currentFilter.minStars > 0) {
-            if (getStars(diff) < currentFilter.minStars) {
+            if (starsCheck == BoundCheck::Fails) {
                 return false;
             }
+            if (starsCheck == BoundCheck::Edge) {
+                float stars = getStars(diff, leaderboard);
+                if (checkMaxStars && stars > currentFilter.maxStars) {
+                    return false;
+                }
+                if (checkMinStars && stars < currentFilter.minStars) {
+                    return false;
+                }
+            }
+        }
+
+        auto njsCheck = quantized ? QuantizedColumns::Check(quantized->njs, currentFilter.njsBoundsPreprocessed) : BoundCheck::Edge;
+        if (njsCheck == BoundCheck::Fails) {
+            return false;
+        }
+
+        auto npsCheck = BoundCheck::Edge;
+        if (quantized) {
+            npsCheck = quantized->nps == QuantizedColumns::NO_VALUE
+                           ? BoundCheck::Passes
+                           : QuantizedColumns::Check(quantized->nps, currentFilter.npsBoundsPreprocessed);
+        }
+        if (npsCheck == BoundCheck::Fails) {
+            return false;
         }
 
         if (static_cast<FilterTypes::DifficultyFilter>(currentFilter.difficultyFilter) != FilterTypes::DifficultyFilter::All) {
@@ -261,43 +319,26 @@ namespace BetterSongSearch::Util {
             }
         }
 
-        if (diff->njs < currentFilter.minNJS || diff->njs > currentFilter.maxNJS) {
+        if (njsCheck == BoundCheck::Edge && (diff->njs < currentFilter.minNJS || diff->njs > currentFilter.maxNJS)) {
             return false;
         }
 
-        if (static_cast<FilterTypes::Requirement>(currentFilter.modRequirement) != FilterTypes::Requirement::Any) {
-            switch (static_cast<FilterTypes::Requirement>(currentFilter.modRequirement)) {
-                case FilterTypes::Requirement::Chroma:
-                    if (!hasFlags(diff->mods, MapMods::Chroma)) {
-                        return false;
-                    }
-                    break;
-                case FilterTypes::Requirement::Cinema:
-                    if (!hasFlags(diff->mods, MapMods::Cinema)) {
-                        return false;
-                    }
-                    break;
-                case FilterTypes::Requirement::MappingExtensions:
-                    if (!hasFlags(diff->mods, MapMods::MappingExtensions)) {
-                        return false;
-                    }
-                    break;
-                case FilterTypes::Requirement::NoodleExtensions:
-                    if (!hasFlags(diff->mods, MapMods::NoodleExtensions)) {
-                        return false;
-                    }
-                    break;
-                case FilterTypes::Requirement::None:
-                    if (!((diff->mods & (MapMods::NE | MapMods::ME)) == MapMods::None)) {
-                        return false;
-                    }
-                    break;
-                default:
-                    break;
+        // Per difficulty local scores, a bit test in the played difficulties bitmap
+        if (static_cast<FilterTypes::LocalScoreFilter>(currentFilter.localScoreType) == FilterTypes::LocalScoreFilter::HidePlayedDiffs) {
+            if (dataHolder.DiffIsPlayed(diff, song)) {
+                return false;
+            }
+        } else if (static_cast<FilterTypes::LocalScoreFilter>(currentFilter.localScoreType) == FilterTypes::LocalScoreFilter::OnlyPlayedDiffs) {
+            if (!dataHolder.DiffIsPlayed(diff, song)) {
+                return false;
             }
         }
 
-        if (song->songDurationSeconds > 0) {
+        if (!MeetsModRequirement(diff, static_cast<FilterTypes::Requirement>(currentFilter.modRequirement))) {
+            return false;
+        }
+
+        if (npsCheck == BoundCheck::Edge && song->songDurationSeconds > 0) {
             float nps = (float) diff->notes / (float) song->songDurationSeconds;
 
             if (nps < currentFilter.minNPS || nps > currentFilter.maxNPS) {
@@ -308,6 +349,103 @@ namespace BetterSongSearch::Util {
         return true;
     }
 
+    DiffFilterResult EvaluateDifficulties(SongDetailsCache::Song const* song) {
+        DiffFilterResult result;
+        // The leaderboard only depends on the song, not on the difficulty
+        auto leaderboard = TargetedRankLeaderboardService(
+            song->rankedStates, static_cast<FilterTypes::RankedFilter>(dataHolder.filterOptionsCache.rankedType), dataHolder.preferredLeaderboard
+        );
+        uint32_t i = 0;
+        for (auto const& diff : *song) {
+            if (DifficultyCheck(&diff, song, leaderboard)) {
+                result.anyPasses = true;
+                if (i < 64) {
+                    result.passingDiffs |= 1ull << i;
+                }
+                float stars = getStars(&diff, leaderboard);
+                if (stars > 0) {
+                    result.minStars = result.minStars > 0 ? std::min(result.minStars, stars) : stars;
+                    result.maxStars = std::max(result.maxStars, stars);
+                }
+            }
+            i++;
+        }
+        return result;
+    }
+
+    DiffLabelOrder OrderDifficultyLabels(SongDetailsCache::Song const* song, FilterTypes::SortMode sort, DiffFilterResult const* result) {
+        struct LabelKey {
+            uint8_t diffIndex;
+            bool ranked;
+            int passScore;
+            float starKey;
+        };
+
+        // Same order the cell used to get from three stable sorts, the last one (ranked) being the primary key
+        auto before = [](LabelKey const& a, LabelKey const& b) {
+            if (a.ranked != b.ranked) {
+                return !a.ranked;
+            }
+            if (a.starKey != b.starKey) {
+                return a.starKey < b.starKey;
+            }
+            return a.passScore > b.passScore;
+        };
+
+        // Only the first labels are kept, inserted after equal keys so the order stays stable
+        std::array<LabelKey, DiffLabelOrder::MAX_LABELS> keys;
+        std::size_t keyCount = 0;
+        // One snapshot for all difficulties of the song
+        auto column = dataHolder.GetStarColumn();
+        auto leaderboard = TargetedRankLeaderboardService(
+            song->rankedStates, static_cast<FilterTypes::RankedFilter>(dataHolder.filterOptionsCache.rankedType), dataHolder.preferredLeaderboard
+        );
+        uint32_t i = 0;
+        for (auto const& diff : *song) {
+            bool passes = result && i < 64 ? (result->passingDiffs >> i) & 1 : DifficultyCheck(&diff, song);
+            std::optional<float> columnStars = column ? column->Get(&diff, song) : std::nullopt;
+            float stars = columnStars ? *columnStars : getStars(&diff, leaderboard);
+            float starKey = 0;
+            if (sort == FilterTypes::SortMode::Most_Stars) {
+                starKey = -stars;
+            } else if (sort == FilterTypes::SortMode::Least_Stars) {
+                starKey = stars > 0 ? stars : -420.0f;
+            }
+            LabelKey key{
+                static_cast<uint8_t>(i),
+                stars > 0,
+                (passes ? 1 : -3) + (diff.characteristic == SongDetailsCache::MapCharacteristic::Standard ? 1 : 0),
+                starKey,
+            };
+            i++;
+
+            auto pos = std::upper_bound(keys.begin(), keys.begin() + keyCount, key, before) - keys.begin();
+            if (static_cast<std::size_t>(pos) >= keys.size()) {
+                continue;
+            }
+            std::size_t last = std::min(keyCount, keys.size() - 1);
+            std::move_backward(keys.begin() + pos, keys.begin() + last, keys.begin() + last + 1);
+            keys[pos] = key;
+            keyCount = std::min(keyCount + 1, keys.size());
+        }
+
+        DiffLabelOrder order;
+        order.count = static_cast<uint8_t>(keyCount);
+        for (std::size_t k = 0; k < order.count; k++) {
+            order.diffs[k] = keys[k].diffIndex;
+        }
+        return order;
+    }
+
+    bool DifficultyPasses(SongDetailsCache::SongDifficulty const* diff, SongDetailsCache::Song const* song) {
+        auto result = dataHolder.GetDiffFilterResult(song);
+        auto i = diff - &*song->begin();
+        if (!result || i >= 64) {
+            return DifficultyCheck(diff, song);
+        }
+        return (result->passingDiffs >> i) & 1;
+    }
+
     using SortFunction = std::function<float(SongDetailsCache::Song const*)>;
     std::unordered_map<FilterTypes::SortMode, SortFunction> sortFunctionMap = {
         {FilterTypes::SortMode::Newest,
@@ -330,6 +468,9 @@ namespace BetterSongSearch::Util {
         {FilterTypes::SortMode::Most_Stars,
          [](SongDetailsCache::Song const* x)  // Most Stars
          {
+             if (auto result = dataHolder.GetDiffFilterResult(x)) {
+                 return result->maxStars;
+             }
              return x->max([x](auto const& diff) {
                  bool passesFilter = DifficultyCheck(&diff, x);
                  if (passesFilter && (getStars(&diff) > 0)) {
@@ -342,6 +483,9 @@ namespace BetterSongSearch::Util {
         {FilterTypes::SortMode::Least_Stars,
          [](SongDetailsCache::Song const* x)  // Least Stars
          {
+             if (auto result = dataHolder.GetDiffFilterResult(x)) {
+                 return 420.0f - (result->minStars > 0 ? result->minStars : 420.0f);
+             }
              return 420.0f - x->min([x](auto const& diff) {
                  bool passesFilter = DifficultyCheck(&diff, x);
                  if (passesFilter && (getStars(&diff) > 0)) {
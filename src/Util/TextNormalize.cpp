@@ -0,0 +1,369 @@
+#include "Util/TextNormalize.hpp"
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace BetterSongSearch::Util {
+    // Normalized ASCII character, 0 means the character is removed
+    static constexpr std::array<char, 128> asciiMap = [] {
+        std::array<char, 128> map = {};
+        for (int c = 'a'; c <= 'z'; c++) {
+            map[c] = static_cast<char>(c);
+        }
+        for (int c = 'A'; c <= 'Z'; c++) {
+            map[c] = static_cast<char>(c - 'A' + 'a');
+        }
+        for (int c = '0'; c <= '9'; c++) {
+            map[c] = static_cast<char>(c);
+        }
+        map[' '] = ' ';
+        return map;
+    }();
+
+    // Latin-1 letters U+00C0 - U+00DF, the lowercase ones (U+00E0 - U+00FF) are the same except for ß and ÿ
+    static constexpr std::array<std::string_view, 32> latin1Map = {
+        "a", "a", "a", "a", "a", "a", "ae", "c", "e", "e", "e", "e", "i", "i", "i",  "i",
+        "d", "n", "o", "o", "o", "o", "o",  "",  "o", "u", "u", "u", "u", "y", "th", "ss",
+    };
+
+    // Latin Extended-A U+0100 - U+017F base letters
+    static constexpr std::string_view latinExtendedAMap =
+        "aaaaaaccccccccdd"
+        "ddeeeeeeeeeegggg"
+        "gggghhhhiiiiiiii"
+        "iiiijjkkklllllll"
+        "lllnnnnnnnnnoooo"
+        "oooorrrrrrssssss"
+        "ssttttttuuuuuuuu"
+        "uuuuwwyyyzzzzzzs";
+
+    // Hepburn romaji for U+3041 - U+3096, small kana are handled separately
+    static constexpr std::array<std::string_view, 86> hiraganaRomaji = {
+        "a",  "a",  "i",  "i",  "u",  "u",  "e",  "e",  "o",  "o",                                    // ぁ - お
+        "ka", "ga", "ki", "gi", "ku", "gu", "ke", "ge", "ko", "go",                                   // か - ご
+        "sa", "za", "shi", "ji", "su", "zu", "se", "ze", "so", "zo",                                  // さ - ぞ
+        "ta", "da", "chi", "ji", "",  "tsu", "zu", "te", "de", "to", "do",                            // た - ど
+        "na", "ni", "nu", "ne", "no",                                                                 // な - の
+        "ha", "ba", "pa", "hi", "bi", "pi", "fu", "bu", "pu", "he", "be", "pe", "ho", "bo", "po",     // は - ぽ
+        "ma", "mi", "mu", "me", "mo",                                                                 // ま - も
+        "ya", "ya", "yu", "yu", "yo", "yo",                                                           // ゃ - よ
+        "ra", "ri", "ru", "re", "ro",                                                                 // ら - ろ
+        "wa", "wa", "i",  "e",  "o",  "n",  "vu", "ka", "ke",                                         // ゎ - ゖ
+    };
+
+    static constexpr char32_t HIRAGANA_FIRST = 0x3041;
+    static constexpr char32_t HIRAGANA_LAST = 0x3096;
+
+    static bool IsAscii(std::string_view text) {
+        auto data = reinterpret_cast<uint8_t const*>(text.data());
+        std::size_t size = text.size();
+        std::size_t i = 0;
+#if defined(__aarch64__)
+        uint8x16_t acc = vdupq_n_u8(0);
+        for (; i + 16 <= size; i += 16) {
+            acc = vorrq_u8(acc, vld1q_u8(data + i));
+        }
+        if (vmaxvq_u8(acc) & 0x80) {
+            return false;
+        }
+#else
+        uint64_t acc = 0;
+        for (; i + 8 <= size; i += 8) {
+            uint64_t word;
+            std::memcpy(&word, data + i, sizeof(word));
+            acc |= word;
+        }
+        if (acc & 0x8080808080808080ull) {
+            return false;
+        }
+#endif
+        for (; i < size; i++) {
+            if (data[i] & 0x80) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Decodes one code point at the start of text
+    // @param length receives the number of bytes used, invalid sequences use 1 byte and return 0
+    static char32_t DecodeUtf8(std::string_view text, std::size_t& length) {
+        auto data = reinterpret_cast<uint8_t const*>(text.data());
+        uint8_t lead = data[0];
+        std::size_t needed;
+        char32_t cp;
+        if (lead < 0x80) {
+            length = 1;
+            return lead;
+        } else if ((lead & 0xE0) == 0xC0) {
+            needed = 1;
+            cp = lead & 0x1F;
+        } else if ((lead & 0xF0) == 0xE0) {
+            needed = 2;
+            cp = lead & 0x0F;
+        } else if ((lead & 0xF8) == 0xF0) {
+            needed = 3;
+            cp = lead & 0x07;
+        } else {
+            length = 1;
+            return 0;
+        }
+
+        if (text.size() <= needed) {
+            length = 1;
+            return 0;
+        }
+        for (std::size_t i = 1; i <= needed; i++) {
+            if ((data[i] & 0xC0) != 0x80) {
+                length = 1;
+                return 0;
+            }
+            cp = (cp << 6) | (data[i] & 0x3F);
+        }
+        length = needed + 1;
+        return cp;
+    }
+
+    static void AppendUtf8(char32_t cp, std::string& out) {
+        if (cp < 0x80) {
+            out.push_back(static_cast<char>(cp));
+        } else if (cp < 0x800) {
+            out.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+            out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        } else if (cp < 0x10000) {
+            out.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+            out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        } else {
+            out.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+            out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        }
+    }
+
+    static void AppendNormalized(char32_t cp, std::string& out) {
+        if (cp < 0x80) {
+            if (char c = asciiMap[cp]) {
+                out.push_back(c);
+            }
+            return;
+        }
+        // C1 controls, Latin-1 punctuation and symbols
+        if (cp < 0xC0 || cp == 0xD7 || cp == 0xF7) {
+            return;
+        }
+        if (cp <= 0xFF) {
+            if (cp == 0xFF) {
+                out.push_back('y');
+            } else if (cp == 0xDF) {
+                out.append("ss");
+            } else {
+                out.append(latin1Map[(cp - 0xC0) % 32]);
+            }
+            return;
+        }
+        if (cp <= 0x17F) {
+            if (cp == 0x132 || cp == 0x133) {
+                out.append("ij");
+            } else if (cp == 0x152 || cp == 0x153) {
+                out.append("oe");
+            } else {
+                out.push_back(latinExtendedAMap[cp - 0x100]);
+            }
+            return;
+        }
+        // Combining diacritical marks
+        if (cp >= 0x300 && cp <= 0x36F) {
+            return;
+        }
+
+        if (cp >= 0x391 && cp <= 0x3A9) {
+            // Greek uppercase
+            cp += 0x20;
+        } else if (cp >= 0x3AC && cp <= 0x3CE) {
+            // Greek lowercase with tonos
+            switch (cp) {
+                case 0x3AC:
+                    cp = 0x3B1;
+                    break;
+                case 0x3AD:
+                    cp = 0x3B5;
+                    break;
+                case 0x3AE:
+                    cp = 0x3B7;
+                    break;
+                case 0x3AF:
+                    cp = 0x3B9;
+                    break;
+                case 0x3CC:
+                    cp = 0x3BF;
+                    break;
+                case 0x3CD:
+                    cp = 0x3C5;
+                    break;
+                case 0x3CE:
+                    cp = 0x3C9;
+                    break;
+                default:
+                    break;
+            }
+        } else if (cp >= 0x410 && cp <= 0x42F) {
+            // Cyrillic uppercase
+            cp += 0x20;
+        } else if (cp >= 0x400 && cp <= 0x40F) {
+            // Cyrillic uppercase with diacritics
+            cp += 0x50;
+        } else if (cp >= 0x2000 && cp <= 0x2BFF) {
+            // General punctuation, symbols, arrows, math, box drawing...
+            return;
+        } else if (cp == 0x3000) {
+            // Ideographic space
+            out.push_back(' ');
+            return;
+        } else if ((cp >= 0x3001 && cp <= 0x3004) || (cp >= 0x3008 && cp <= 0x3020) || cp == 0x30FB) {
+            // CJK punctuation and brackets
+            return;
+        } else if (cp >= 0x30A1 && cp <= 0x30F6) {
+            // Katakana to hiragana
+            cp -= 0x60;
+        } else if (cp >= 0xFF01 && cp <= 0xFF5E) {
+            // Fullwidth ASCII
+            AppendNormalized(cp - 0xFEE0, out);
+            return;
+        } else if ((cp >= 0xFE00 && cp <= 0xFE0F) || (cp >= 0xFE30 && cp <= 0xFE6F) || (cp >= 0xFF5F && cp <= 0xFF64)) {
+            // Variation selectors, CJK compatibility forms and halfwidth punctuation
+            return;
+        } else if ((cp >= 0x1F000 && cp <= 0x1FAFF) || cp >= 0xE0000) {
+            // Emoji and tags
+            return;
+        }
+
+        AppendUtf8(cp, out);
+    }
+
+    void NormalizeSearchText(std::string_view text, std::string& out) {
+        if (IsAscii(text)) {
+            out.reserve(out.size() + text.size());
+            for (char c : text) {
+                if (char mapped = asciiMap[static_cast<uint8_t>(c)]) {
+                    out.push_back(mapped);
+                }
+            }
+            return;
+        }
+
+        out.reserve(out.size() + text.size());
+        while (!text.empty()) {
+            std::size_t length;
+            char32_t cp = DecodeUtf8(text, length);
+            text.remove_prefix(length);
+            if (cp != 0) {
+                AppendNormalized(cp, out);
+            }
+        }
+    }
+
+    std::string NormalizeSearchText(std::string_view text) {
+        std::string out;
+        NormalizeSearchText(text, out);
+        return out;
+    }
+
+    bool ContainsKana(std::string_view normalized) {
+        if (IsAscii(normalized)) {
+            return false;
+        }
+        while (!normalized.empty()) {
+            std::size_t length;
+            char32_t cp = DecodeUtf8(normalized, length);
+            normalized.remove_prefix(length);
+            if (cp >= HIRAGANA_FIRST && cp <= HIRAGANA_LAST) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static bool IsRomajiVowel(char c) {
+        return c == 'a' || c == 'i' || c == 'u' || c == 'e' || c == 'o';
+    }
+
+    void KanaToRomaji(std::string_view normalized, std::string& out) {
+        bool doubleNext = false;  // After a small tsu the next consonant is doubled
+        std::size_t kanaEnd = std::string::npos;  // End of the last transliterated kana in out
+        std::size_t kanaStart = 0;  // Start of the last transliterated kana in out, after a doubled consonant
+
+        while (!normalized.empty()) {
+            std::size_t length;
+            char32_t cp = DecodeUtf8(normalized, length);
+            normalized.remove_prefix(length);
+
+            // Long vowel mark is not written in romaji
+            if (cp == 0x30FC) {
+                continue;
+            }
+            if (cp < HIRAGANA_FIRST || cp > HIRAGANA_LAST) {
+                if (cp != 0) {
+                    AppendUtf8(cp, out);
+                }
+                doubleNext = false;
+                continue;
+            }
+
+            std::size_t index = cp - HIRAGANA_FIRST;
+            bool afterKana = kanaEnd == out.size() && !out.empty();
+            // Small kana only combine with a consonant kana (ki, shi, fu), not with a lone vowel (い, う)
+            bool afterConsonantKana = afterKana && out.size() - kanaStart >= 2 && !IsRomajiVowel(out[out.size() - 2]);
+
+            switch (cp) {
+                case 0x3063:  // っ
+                    doubleNext = true;
+                    continue;
+                case 0x3083:  // ゃ
+                case 0x3085:  // ゅ
+                case 0x3087:  // ょ
+                    // Combined sound: ki + ya -> kya, shi + ya -> sha
+                    if (afterConsonantKana && out.back() == 'i') {
+                        out.pop_back();
+                        char vowel = hiraganaRomaji[index][1];
+                        bool palatal = out.back() == 'j' || (out.size() >= 2 && out[out.size() - 1] == 'h' && (out[out.size() - 2] == 's' || out[out.size() - 2] == 'c'));
+                        if (!palatal) {
+                            out.push_back('y');
+                        }
+                        out.push_back(vowel);
+                        kanaEnd = out.size();
+                        continue;
+                    }
+                    break;
+                case 0x3041:  // ぁ
+                case 0x3043:  // ぃ
+                case 0x3045:  // ぅ
+                case 0x3047:  // ぇ
+                case 0x3049:  // ぉ
+                    // Extended sound: fu + a -> fa
+                    if (afterConsonantKana && (out.back() == 'u' || out.back() == 'i' || out.back() == 'o')) {
+                        out.back() = hiraganaRomaji[index][0];
+                        continue;
+                    }
+                    break;
+                default:
+                    break;
+            }
+
+            std::string_view romaji = hiraganaRomaji[index];
+            if (doubleNext && !romaji.empty() && !IsRomajiVowel(romaji[0]) && romaji[0] != 'n') {
+                out.push_back(romaji[0] == 'c' ? 't' : romaji[0]);
+            }
+            doubleNext = false;
+            kanaStart = out.size();
+            out.append(romaji);
+            kanaEnd = out.size();
+        }
+    }
+}  // namespace BetterSongSearch::Util
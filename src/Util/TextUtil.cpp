@@ -44,12 +44,11 @@ namespace BetterSongSearch::Util {
      * Removes special characters from a string
      */
     std::string removeSpecialCharacter(std::string_view const s) {
-        std::string stringy(s);
-        for (int i = 0; i < stringy.size(); i++) {
-            if (stringy[i] != ' ' && (stringy[i] < 'A' || stringy[i] > 'Z') && (stringy[i] < 'a' || stringy[i] > 'z') &&
-                (stringy[i] < '0' || stringy[i] > '9')) {
-                stringy.erase(i, 1);
-                i--;
+        std::string stringy;
+        stringy.reserve(s.size());
+        for (char c : s) {
+            if (c == ' ' || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9')) {
+                stringy.push_back(c);
             }
         }
         return stringy;
@@ -69,7 +68,8 @@ namespace BetterSongSearch::Util {
     }
 
     bool IsSpace(char x) {
-        return x == ' ' || !isalnum(x);
+        // Bytes of multibyte UTF-8 characters are part of a word
+        return x == ' ' || (static_cast<unsigned char>(x) < 0x80 && !isalnum(x));
     };
 
     std::string httpErrorToString(int code) {
@@ -0,0 +1,361 @@
+#include "Util/TokenIndex.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <unordered_map>
+
+namespace BetterSongSearch::Util {
+    static constexpr uint8_t NO_POSITION = 255;
+
+    template <typename F>
+    static void ForEachToken(std::string_view text, F&& callback) {
+        while (!text.empty()) {
+            auto start = text.find_first_not_of(' ');
+            if (start == std::string_view::npos) {
+                break;
+            }
+            text.remove_prefix(start);
+            auto token = text.substr(0, text.find(' '));
+            callback(token);
+            text.remove_prefix(token.size());
+        }
+    }
+
+    void TokenIndex::Clear() {
+        terms.Clear();
+        termDocCount.clear();
+        postingOffsets.clear();
+        postings.clear();
+        for (auto& lengths : fieldLengths) {
+            lengths.clear();
+        }
+        averageFieldLengths = {};
+        songCount = 0;
+    }
+
+    void TokenIndex::Build(TextColumn const& songNames, ArtistTable const& artists, TextColumn const& levelAuthors) {
+        Clear();
+        songCount = static_cast<uint32_t>(songNames.size());
+
+        struct Occurrence {
+            uint32_t term;
+            uint32_t song;
+            SearchField field;
+            uint8_t position;
+        };
+
+        // Columns are complete, so the term views stay valid while building
+        std::unordered_map<std::string_view, uint32_t> termIds;
+        std::vector<std::string_view> termTexts;
+        std::vector<Occurrence> occurrences;
+        occurrences.reserve(songCount * 6);
+
+        auto addField = [&](uint32_t song, std::string_view text, SearchField field) {
+            uint32_t count = 0;
+            ForEachToken(text, [&](std::string_view token) {
+                auto [it, inserted] = termIds.try_emplace(token, static_cast<uint32_t>(termTexts.size()));
+                if (inserted) {
+                    termTexts.push_back(token);
+                }
+                occurrences.push_back({it->second, song, field, static_cast<uint8_t>(std::min<uint32_t>(count, NO_POSITION - 1))});
+                count++;
+            });
+            fieldLengths[static_cast<std::size_t>(field)][song] = static_cast<uint8_t>(std::min<uint32_t>(count, 255));
+        };
+
+        for (auto& lengths : fieldLengths) {
+            lengths.assign(songCount, 0);
+        }
+        for (uint32_t song = 0; song < songCount; song++) {
+            addField(song, songNames.at(song), SearchField::SongName);
+            addField(song, artists.Name(artists.ArtistOf(song)), SearchField::Artist);
+            addField(song, levelAuthors.at(song), SearchField::LevelAuthor);
+        }
+
+        // Sorted terms make prefix lookups a binary search
+        std::vector<uint32_t> order(termTexts.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+            return termTexts[a] < termTexts[b];
+        });
+        std::vector<uint32_t> remap(termTexts.size());
+        std::size_t termBytes = 0;
+        for (uint32_t i = 0; i < order.size(); i++) {
+            remap[order[i]] = i;
+            termBytes += termTexts[order[i]].size();
+        }
+        terms.Reserve(order.size(), termBytes);
+        for (uint32_t id : order) {
+            terms.Push(termTexts[id]);
+        }
+
+        // Counting sort by term, occurrences are in song order so each term stays sorted by song
+        std::vector<uint32_t> termStarts(order.size() + 1, 0);
+        for (auto const& occurrence : occurrences) {
+            termStarts[remap[occurrence.term] + 1]++;
+        }
+        std::partial_sum(termStarts.begin(), termStarts.end(), termStarts.begin());
+        std::vector<Occurrence> sorted(occurrences.size());
+        {
+            std::vector<uint32_t> cursors(termStarts.begin(), termStarts.end() - 1);
+            for (auto const& occurrence : occurrences) {
+                uint32_t term = remap[occurrence.term];
+                sorted[cursors[term]++] = {term, occurrence.song, occurrence.field, occurrence.position};
+            }
+        }
+        occurrences = {};
+
+        // Merge the occurrences of a term in the same song into one posting
+        postingOffsets.reserve(order.size() + 1);
+        termDocCount.reserve(order.size());
+        postings.reserve(sorted.size());
+        for (uint32_t term = 0; term < order.size(); term++) {
+            uint32_t termStart = static_cast<uint32_t>(postings.size());
+            postingOffsets.push_back(termStart);
+            for (uint32_t i = termStarts[term]; i < termStarts[term + 1]; i++) {
+                auto const& occurrence = sorted[i];
+                if (postings.size() == termStart || postings.back().song != occurrence.song) {
+                    postings.push_back({occurrence.song, {0, 0, 0}, NO_POSITION});
+                }
+                auto& posting = postings.back();
+                auto& tf = posting.tf[static_cast<std::size_t>(occurrence.field)];
+                if (tf < 255) {
+                    tf++;
+                }
+                if (occurrence.field == SearchField::SongName) {
+                    posting.namePosition = std::min(posting.namePosition, occurrence.position);
+                }
+            }
+            termDocCount.push_back(static_cast<uint32_t>(postings.size()) - termStart);
+        }
+        postingOffsets.push_back(static_cast<uint32_t>(postings.size()));
+
+        for (std::size_t field = 0; field < SEARCH_FIELD_COUNT; field++) {
+            uint64_t total = 0;
+            for (auto length : fieldLengths[field]) {
+                total += length;
+            }
+            averageFieldLengths[field] = songCount > 0 ? std::max(1.0f, static_cast<float>(total) / songCount) : 1.0f;
+        }
+    }
+
+    std::size_t TokenIndex::bytes() const {
+        std::size_t size = terms.bytes() + termDocCount.size() * sizeof(uint32_t) + postingOffsets.size() * sizeof(uint32_t) + postings.size() * sizeof(Posting);
+        for (auto const& lengths : fieldLengths) {
+            size += lengths.size();
+        }
+        return size;
+    }
+
+    float TokenIndex::ScorePosting(Posting const& posting, float idf) const {
+        // BM25F: length normalized term frequencies are boosted per field, then saturated once
+        float weighted = 0;
+        for (std::size_t field = 0; field < SEARCH_FIELD_COUNT; field++) {
+            if (posting.tf[field] == 0) {
+                continue;
+            }
+            float lengthRatio = fieldLengths[field][posting.song] / averageFieldLengths[field];
+            weighted += params.fieldBoosts[field] * posting.tf[field] / (1.0f - params.b + params.b * lengthRatio);
+        }
+        return idf * weighted * (params.k1 + 1.0f) / (weighted + params.k1);
+    }
+
+    void TokenIndex::CollectWordPostings(std::string_view word, std::vector<QueryPosting>& out) const {
+        out.clear();
+
+        // Terms starting with the word are a contiguous range
+        uint32_t first = 0;
+        uint32_t count = static_cast<uint32_t>(terms.size());
+        while (count > 0) {
+            uint32_t step = count / 2;
+            if (terms.at(first + step) < word) {
+                first += step + 1;
+                count -= step + 1;
+            } else {
+                count = step;
+            }
+        }
+        uint32_t last = first;
+        while (last < terms.size() && terms.at(last).starts_with(word)) {
+            last++;
+        }
+        if (first == last) {
+            return;
+        }
+
+        std::vector<uint32_t> expansions(last - first);
+        std::iota(expansions.begin(), expansions.end(), first);
+        if (expansions.size() > params.maxPrefixExpansions) {
+            // Keep the exact term and the most common ones
+            bool hasExact = terms.at(first) == word;
+            auto begin = expansions.begin() + (hasExact ? 1 : 0);
+            std::nth_element(begin, begin + (params.maxPrefixExpansions - 1), expansions.end(), [this](uint32_t a, uint32_t b) {
+                return termDocCount[a] > termDocCount[b];
+            });
+            expansions.resize(params.maxPrefixExpansions);
+        }
+
+        for (uint32_t term : expansions) {
+            float docCount = static_cast<float>(termDocCount[term]);
+            float idf = std::log(1.0f + (songCount - docCount + 0.5f) / (docCount + 0.5f));
+            float factor = terms.at(term) == word ? 1.0f : params.prefixFactor;
+            for (uint32_t i = postingOffsets[term]; i < postingOffsets[term + 1]; i++) {
+                out.push_back({postings[i].song, factor * ScorePosting(postings[i], idf), postings[i].namePosition});
+            }
+        }
+
+        if (expansions.size() > 1) {
+            // A song can contain several expansions, keep the best one
+            std::sort(out.begin(), out.end(), [](QueryPosting const& a, QueryPosting const& b) {
+                return a.song < b.song;
+            });
+            std::size_t kept = 0;
+            for (std::size_t i = 0; i < out.size(); i++) {
+                if (kept > 0 && out[kept - 1].song == out[i].song) {
+                    out[kept - 1].score = std::max(out[kept - 1].score, out[i].score);
+                    out[kept - 1].namePosition = std::min(out[kept - 1].namePosition, out[i].namePosition);
+                } else {
+                    out[kept++] = out[i];
+                }
+            }
+            out.resize(kept);
+        }
+    }
+
+    void TokenIndex::TopK(std::vector<std::string_view> const& words, std::size_t k, std::vector<uint64_t> const* allowed, std::vector<Result>& out) const {
+        out.clear();
+        std::size_t wordCount = words.size();
+        if (wordCount == 0 || k == 0 || songCount == 0) {
+            return;
+        }
+
+        std::vector<std::vector<QueryPosting>> lists(wordCount);
+        std::vector<float> upperBounds(wordCount, 0);
+        for (std::size_t i = 0; i < wordCount; i++) {
+            CollectWordPostings(words[i], lists[i]);
+            for (auto const& posting : lists[i]) {
+                upperBounds[i] = std::max(upperBounds[i], posting.score);
+            }
+            // The proximity bonus of a word pair is counted for the second word
+            if (i > 0 && !lists[i].empty()) {
+                upperBounds[i] += params.proximityBonus;
+            }
+        }
+
+        // MaxScore: lists sorted by upper bound, the ones whose bounds add up to less than the
+        // current k-th score are non-essential, songs only found in them can't make it into the top k
+        std::vector<std::size_t> order(wordCount);
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+            return upperBounds[a] < upperBounds[b];
+        });
+        std::vector<float> boundSums(wordCount);
+        float boundSum = 0;
+        for (std::size_t j = 0; j < wordCount; j++) {
+            boundSum += upperBounds[order[j]];
+            boundSums[j] = boundSum;
+        }
+
+        // Heap ordered so the front is the worst result (lowest score, then highest song index)
+        auto better = [](Result const& a, Result const& b) {
+            return a.score > b.score || (a.score == b.score && a.songIndex < b.songIndex);
+        };
+        std::vector<Result> heap;
+        heap.reserve(std::min<std::size_t>(k, songCount));
+        float threshold = 0;
+        std::size_t firstEssential = 0;
+
+        std::vector<std::size_t> cursors(wordCount, 0);
+        std::vector<uint8_t> positions(wordCount);
+        std::vector<float> contributions(wordCount);
+
+        while (true) {
+            uint32_t candidate = UINT32_MAX;
+            for (std::size_t j = firstEssential; j < wordCount; j++) {
+                auto const& list = lists[order[j]];
+                if (cursors[order[j]] < list.size()) {
+                    candidate = std::min(candidate, list[cursors[order[j]]].song);
+                }
+            }
+            if (candidate == UINT32_MAX) {
+                break;
+            }
+
+            bool isAllowed = allowed == nullptr || (candidate / 64 < allowed->size() && ((*allowed)[candidate / 64] >> (candidate % 64)) & 1);
+            float score = 0;
+            float pendingBonus = 0;  // Proximity bonus the matched words can still add
+            std::fill(positions.begin(), positions.end(), NO_POSITION);
+            std::fill(contributions.begin(), contributions.end(), 0.0f);
+
+            for (std::size_t j = firstEssential; j < wordCount; j++) {
+                std::size_t word = order[j];
+                auto const& list = lists[word];
+                if (cursors[word] < list.size() && list[cursors[word]].song == candidate) {
+                    contributions[word] = list[cursors[word]].score;
+                    score += contributions[word];
+                    positions[word] = list[cursors[word]].namePosition;
+                    cursors[word]++;
+                    if (word > 0) {
+                        pendingBonus += params.proximityBonus;
+                    }
+                }
+            }
+            if (!isAllowed) {
+                continue;
+            }
+
+            // Non-essential lists, highest bound first, stop once the song can't make it anymore
+            for (std::size_t j = firstEssential; j-- > 0;) {
+                if (heap.size() == k && score + pendingBonus + boundSums[j] < threshold) {
+                    break;
+                }
+                std::size_t word = order[j];
+                auto const& list = lists[word];
+                auto it = std::lower_bound(list.begin() + cursors[word], list.end(), candidate, [](QueryPosting const& posting, uint32_t song) {
+                    return posting.song < song;
+                });
+                cursors[word] = it - list.begin();
+                if (it != list.end() && it->song == candidate) {
+                    contributions[word] = it->score;
+                    score += contributions[word];
+                    positions[word] = it->namePosition;
+                    if (word > 0) {
+                        pendingBonus += params.proximityBonus;
+                    }
+                }
+            }
+
+            // Summed in query order so the score doesn't depend on which lists were essential
+            score = 0;
+            for (std::size_t i = 0; i < wordCount; i++) {
+                score += contributions[i];
+                if (i > 0 && positions[i - 1] != NO_POSITION && positions[i] == positions[i - 1] + 1) {
+                    score += params.proximityBonus;
+                }
+            }
+
+            Result result{candidate, score};
+            if (heap.size() < k) {
+                heap.push_back(result);
+                std::push_heap(heap.begin(), heap.end(), better);
+            } else if (better(result, heap.front())) {
+                std::pop_heap(heap.begin(), heap.end(), better);
+                heap.back() = result;
+                std::push_heap(heap.begin(), heap.end(), better);
+            } else {
+                continue;
+            }
+
+            if (heap.size() == k) {
+                threshold = heap.front().score;
+                while (firstEssential < wordCount && boundSums[firstEssential] < threshold) {
+                    firstEssential++;
+                }
+            }
+        }
+
+        std::sort_heap(heap.begin(), heap.end(), better);
+        out = std::move(heap);
+    }
+}  // namespace BetterSongSearch::Util
@@ -1,5 +1,7 @@
 #include "main.hpp"
 
+#include <chrono>
+
 #include "_config.h"
 #include "bsml/shared/BSML/SharedCoroutineStarter.hpp"
 #include "bsml/shared/Helpers/delegates.hpp"
@@ -15,6 +17,8 @@
 #include "GlobalNamespace/MultiplayerLevelScenesTransitionSetupDataSO.hpp"
 #include "GlobalNamespace/MultiplayerResultsViewController.hpp"
 #include "GlobalNamespace/PlayerData.hpp"
+#include "GlobalNamespace/PlayerLevelStatsData.hpp"
+#include "GlobalNamespace/RankModel.hpp"
 #include "GlobalNamespace/SelectLevelCategoryViewController.hpp"
 #include "GlobalNamespace/SettingsManager.hpp"
 #include "GlobalNamespace/SongPackMask.hpp"
@@ -237,6 +241,33 @@ MAKE_HOOK_MATCH(
     );
 }
 
+// Keeps the local score index up to date without rescanning all the level stats
+MAKE_HOOK_MATCH(
+    PlayerLevelStatsData_UpdateScoreData,
+    &GlobalNamespace::PlayerLevelStatsData::UpdateScoreData,
+    void,
+    GlobalNamespace::PlayerLevelStatsData* self,
+    int score,
+    int maxCombo,
+    bool fullCombo,
+    GlobalNamespace::RankModel::Rank rank
+) {
+    PlayerLevelStatsData_UpdateScoreData(self, score, maxCombo, fullCombo, rank);
+
+    auto before = std::chrono::steady_clock::now();
+    dataHolder.UpdatePlayerScore(self);
+    auto updateUs = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - before).count();
+#ifdef BSS_SCORE_TIMING
+    // What the same score change cost before the hook, a full rescan on the next activation
+    before = std::chrono::steady_clock::now();
+    std::size_t scoredSongs = dataHolder.LegacyScoreScan();
+    auto rescanUs = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - before).count();
+    INFO("Updated player score in {} us (old full rescan {} us, {} songs)", updateUs, rescanUs, scoredSongs);
+#else
+    INFO("Updated player score in {} us", updateUs);
+#endif
+}
+
 // Called later on in the game loading - a good time to install function hooks
 BSS_EXPORT_FUNC void late_load() {
     il2cpp_functions::Init();
@@ -248,6 +279,7 @@ BSS_EXPORT_FUNC void late_load() {
     INSTALL_HOOK(Logger, LevelFilteringNavigationController_Setup);
     INSTALL_HOOK(Logger, MultiplayerLevelScenesTransitionSetupDataSO_Init);
     INSTALL_HOOK(Logger, MenuTransitionsHelper_RestartGame);
+    INSTALL_HOOK(Logger, PlayerLevelStatsData_UpdateScoreData);
 
     // Automatic testing
     // INSTALL_HOOK(Logger, MainFlowCoordinator_DidActivate);
@@ -0,0 +1,129 @@
+// Host checks of the adaptive search debounce against a fake clock, not part of the mod build.
+// g++ -std=c++20 -DBSS_HOST_TEST -Iinclude test/src/AdaptiveDebounceCases.cpp src/Util/AdaptiveDebounce.cpp src/Util/CurrentTimeMs.cpp -o debounce_cases && ./debounce_cases
+#ifdef BSS_HOST_TEST
+
+#include <cstdio>
+#include <string>
+
+#include "Util/AdaptiveDebounce.hpp"
+
+using namespace BetterSongSearch::Util;
+
+static int failed = 0;
+
+static void CheckEqual(long long actual, long long expected, std::string const& what) {
+    if (actual != expected) {
+        std::printf("FAIL %s: got %lld, expected %lld\n", what.c_str(), actual, expected);
+        failed++;
+    }
+}
+
+static void Check(bool condition, std::string const& what) {
+    if (!condition) {
+        std::printf("FAIL %s\n", what.c_str());
+        failed++;
+    }
+}
+
+// The window is the 75th percentile of the last searches times 1.25
+static void CheckLatencyMapping() {
+    AdaptiveDebounce debounce([] { return 0ll; });
+    CheckEqual(debounce.Percentile(0.75f), -1, "no samples: percentile");
+    CheckEqual(debounce.WindowMs(), debounce.defaultWindowMs, "no samples: default window");
+
+    debounce.RecordLatency(80);
+    CheckEqual(debounce.WindowMs(), 100, "one 80 ms search");
+
+    // 10, 20, ..., 160, the 75th percentile is the 12th
+    AdaptiveDebounce spread([] { return 0ll; });
+    for (long long ms = 10; ms <= 160; ms += 10) {
+        spread.RecordLatency(ms);
+    }
+    CheckEqual(spread.Percentile(0.75f), 120, "spread: percentile");
+    CheckEqual(spread.Percentile(0.0f), 10, "spread: lowest");
+    CheckEqual(spread.Percentile(1.0f), 160, "spread: highest");
+    CheckEqual(spread.WindowMs(), 150, "spread: window");
+
+    // One slow search among fast ones doesn't move the window
+    AdaptiveDebounce outlier([] { return 0ll; });
+    for (int i = 0; i < 7; i++) {
+        outlier.RecordLatency(40);
+    }
+    outlier.RecordLatency(2000);
+    CheckEqual(outlier.WindowMs(), 50, "one outlier");
+}
+
+static void CheckClamping() {
+    AdaptiveDebounce fast([] { return 0ll; });
+    fast.RecordLatency(0);
+    CheckEqual(fast.WindowMs(), fast.minWindowMs, "instant searches: clamped to the minimum");
+
+    AdaptiveDebounce negative([] { return 0ll; });
+    negative.RecordLatency(-50);
+    CheckEqual(negative.Percentile(0.75f), 0, "negative duration is recorded as 0");
+
+    AdaptiveDebounce slow([] { return 0ll; });
+    for (int i = 0; i < 4; i++) {
+        slow.RecordLatency(5000);
+    }
+    CheckEqual(slow.WindowMs(), slow.maxWindowMs, "slow searches: clamped to the maximum");
+}
+
+// Only the last SampleCount searches count, a device that got fast again gets short windows back
+static void CheckDecay() {
+    AdaptiveDebounce debounce([] { return 0ll; });
+    for (std::size_t i = 0; i < AdaptiveDebounce::SampleCount; i++) {
+        debounce.RecordLatency(400);
+    }
+    CheckEqual(debounce.WindowMs(), debounce.maxWindowMs, "slow history");
+
+    long long previous = debounce.WindowMs();
+    bool decreasing = true;
+    for (std::size_t i = 0; i < AdaptiveDebounce::SampleCount; i++) {
+        debounce.RecordLatency(20);
+        decreasing = decreasing && debounce.WindowMs() <= previous;
+        previous = debounce.WindowMs();
+    }
+    Check(decreasing, "window never grows while faster searches come in");
+    CheckEqual(debounce.WindowMs(), 25, "slow searches rolled out");
+
+    // A quarter of slow searches is still under the percentile
+    for (std::size_t i = 0; i < AdaptiveDebounce::SampleCount / 4; i++) {
+        debounce.RecordLatency(400);
+    }
+    CheckEqual(debounce.WindowMs(), 25, "a quarter of slow searches");
+    debounce.RecordLatency(400);
+    CheckEqual(debounce.WindowMs(), debounce.maxWindowMs, "more than a quarter of slow searches");
+}
+
+static void CheckFireImmediately() {
+    long long now = 1000;
+    AdaptiveDebounce debounce([&now] { return now; });
+    Check(!debounce.CanFireImmediately(true), "no samples: default window is not cheap");
+
+    debounce.RecordLatency(20);
+    Check(debounce.CanFireImmediately(true), "cheap searches, never fired");
+    Check(!debounce.CanFireImmediately(false), "pipeline busy");
+
+    debounce.MarkFired();
+    now += debounce.WindowMs() - 1;
+    Check(!debounce.CanFireImmediately(true), "fired within the window");
+    now += 1;
+    Check(debounce.CanFireImmediately(true), "fired a window ago");
+
+    debounce.RecordLatency(200);
+    debounce.RecordLatency(200);
+    now += 10000;
+    Check(!debounce.CanFireImmediately(true), "expensive searches always wait");
+}
+
+int main() {
+    CheckLatencyMapping();
+    CheckClamping();
+    CheckDecay();
+    CheckFireImmediately();
+    std::printf("%d checks failed\n", failed);
+    return failed == 0 ? 0 : 1;
+}
+
+#endif
@@ -0,0 +1,201 @@
+// Host benchmark of the category bitmaps against a linear filter scan, not part of the mod build.
+// g++ -std=c++20 -O2 -DBSS_HOST_TEST -Iinclude test/src/CategoryBitmapBenchmark.cpp src/Util/RoaringBitmap.cpp -o category_bench && ./category_bench
+#ifdef BSS_HOST_TEST
+
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <vector>
+
+#include "Util/RoaringBitmap.hpp"
+
+using namespace BetterSongSearch::Util;
+
+// About the size of the BeatSaver dataset
+static constexpr uint32_t SONG_COUNT = 120000;
+static constexpr int ROUNDS = 50;
+
+// The song fields the categorical filters look at, the dataset keeps them as a tags column and two flag columns
+static constexpr std::size_t TAGS_BYTES = sizeof(uint64_t);
+static constexpr std::size_t FLAGS_BYTES = sizeof(uint8_t);
+
+struct BenchSong {
+    uint64_t tags;
+    bool curated;
+    bool verified;
+    bool ranked;
+};
+
+struct BenchCase {
+    char const* name;
+    std::size_t linearBytesPerSong;  // Column bytes the linear scan reads for every song
+    std::vector<RoaringBitmap const*> bitmaps;  // Bitmaps the combination reads
+    std::function<bool(BenchSong const&)> meetsFilter;
+    std::function<RoaringBitmap()> combine;
+};
+
+template <typename Fn>
+static double AverageMicros(Fn&& fn) {
+    auto before = std::chrono::steady_clock::now();
+    for (int round = 0; round < ROUNDS; round++) {
+        fn();
+    }
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - before;
+    return elapsed.count() / ROUNDS;
+}
+
+int main() {
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> chance(0, 1);
+
+    std::vector<BenchSong> songs(SONG_COUNT);
+    for (auto& song : songs) {
+        // A few common tags and a long tail, like map styles and genres
+        song.tags = 0;
+        for (int tag = 0; tag < 48; tag++) {
+            if (chance(rng) < (tag < 4 ? 0.3 : 0.03)) {
+                song.tags |= 1ull << tag;
+            }
+        }
+        song.curated = chance(rng) < 0.04;
+        song.verified = chance(rng) < 0.25;
+        song.ranked = chance(rng) < 0.06;
+    }
+
+    // Built the same way as PreprocessCategories, in song index order
+    std::vector<RoaringBitmap> tags(64);
+    RoaringBitmap curated;
+    RoaringBitmap verified;
+    RoaringBitmap ranked;
+    for (uint32_t i = 0; i < SONG_COUNT; i++) {
+        auto const& song = songs[i];
+        uint64_t bitfield = song.tags;
+        while (bitfield != 0) {
+            tags[std::countr_zero(bitfield)].Add(i);
+            bitfield &= bitfield - 1;
+        }
+        if (song.curated) {
+            curated.Add(i);
+        }
+        if (song.verified) {
+            verified.Add(i);
+        }
+        if (song.ranked) {
+            ranked.Add(i);
+        }
+    }
+
+    uint64_t styles = (1ull << 0) | (1ull << 2) | (1ull << 9);
+    uint64_t excluded = (1ull << 1) | (1ull << 17);
+    BenchCase cases[] = {
+        {"AND verified, tag 0",
+         TAGS_BYTES + FLAGS_BYTES,
+         {&verified, &tags[0]},
+         [](BenchSong const& song) { return song.verified && (song.tags & 1) != 0; },
+         [&] {
+             RoaringBitmap result = verified;
+             result &= tags[0];
+             return result;
+         }},
+        {"AND curated, ranked",
+         2 * FLAGS_BYTES,
+         {&curated, &ranked},
+         [](BenchSong const& song) { return song.curated && song.ranked; },
+         [&] {
+             RoaringBitmap result = curated;
+             result &= ranked;
+             return result;
+         }},
+        {"OR of 3 tags",
+         TAGS_BYTES,
+         {&tags[0], &tags[2], &tags[9]},
+         [styles](BenchSong const& song) { return (song.tags & styles) != 0; },
+         [&] {
+             RoaringBitmap result;
+             for (int tag : {0, 2, 9}) {
+                 result |= tags[tag];
+             }
+             return result;
+         }},
+        {"ANDNOT ranked, 2 tags",
+         TAGS_BYTES + FLAGS_BYTES,
+         {&ranked, &tags[1], &tags[17]},
+         [excluded](BenchSong const& song) { return song.ranked && (song.tags & excluded) == 0; },
+         [&] {
+             RoaringBitmap result = ranked;
+             result -= tags[1];
+             result -= tags[17];
+             return result;
+         }},
+        {"AND verified, OR 3 tags, ANDNOT 2 tags",
+         TAGS_BYTES + FLAGS_BYTES,
+         {&verified, &tags[0], &tags[2], &tags[9], &tags[1], &tags[17]},
+         [styles, excluded](BenchSong const& song) { return song.verified && (song.tags & styles) != 0 && (song.tags & excluded) == 0; },
+         [&] {
+             RoaringBitmap styleSongs;
+             for (int tag : {0, 2, 9}) {
+                 styleSongs |= tags[tag];
+             }
+             RoaringBitmap result = verified;
+             result &= styleSongs;
+             result -= tags[1];
+             result -= tags[17];
+             return result;
+         }},
+    };
+
+    int failed = 0;
+    std::size_t bitmapBytes = curated.bytes() + verified.bytes() + ranked.bytes();
+    for (auto const& tag : tags) {
+        bitmapBytes += tag.bytes();
+    }
+    std::printf("%zu songs, average of %d rounds\n", songs.size(), ROUNDS);
+    std::printf(
+        "memory: bitmaps %zu KB, linear scan columns %zu KB (tags and 2 flag columns)\n",
+        bitmapBytes / 1024,
+        SONG_COUNT * (TAGS_BYTES + 2 * FLAGS_BYTES) / 1024
+    );
+    for (auto const& test : cases) {
+        std::vector<uint32_t> linear;
+        std::vector<uint32_t> combined;
+        // Both produce the candidate list the filter workers get
+        double linearMicros = AverageMicros([&] {
+            linear.clear();
+            for (uint32_t i = 0; i < SONG_COUNT; i++) {
+                if (test.meetsFilter(songs[i])) {
+                    linear.push_back(i);
+                }
+            }
+        });
+        double bitmapMicros = AverageMicros([&] {
+            combined.clear();
+            test.combine().ToVector(combined);
+        });
+
+        if (linear != combined) {
+            std::printf("FAIL %s: linear scan found %zu songs, bitmaps %zu\n", test.name, linear.size(), combined.size());
+            failed++;
+            continue;
+        }
+        std::size_t readBitmapBytes = 0;
+        for (auto bitmap : test.bitmaps) {
+            readBitmapBytes += bitmap->bytes();
+        }
+        std::printf(
+            "%-40s %6zu songs  linear %8.1f us %5zu KB  bitmaps %8.1f us %5zu KB  (%.1fx)\n",
+            test.name,
+            linear.size(),
+            linearMicros,
+            SONG_COUNT * test.linearBytesPerSong / 1024,
+            bitmapMicros,
+            readBitmapBytes / 1024,
+            linearMicros / bitmapMicros
+        );
+    }
+    return failed == 0 ? 0 : 1;
+}
+
+#endif
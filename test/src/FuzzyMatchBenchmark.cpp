@@ -0,0 +1,105 @@
+// Host benchmark of the bit-parallel fuzzy matcher against the plain edit distance DP, not part of the mod build.
+// g++ -std=c++20 -O2 -DBSS_HOST_TEST -Iinclude test/src/FuzzyMatchBenchmark.cpp src/Util/FuzzyMatch.cpp -o fuzzy_bench && ./fuzzy_bench
+#ifdef BSS_HOST_TEST
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Util/FuzzyMatch.hpp"
+
+using namespace BetterSongSearch::Util;
+
+// Normalized song names are about this long
+static constexpr std::size_t TEXT_COUNT = 120000;
+static constexpr std::size_t MIN_TEXT_LENGTH = 8;
+static constexpr std::size_t MAX_TEXT_LENGTH = 48;
+
+// Smallest edit distance between the pattern and a substring of the text, one DP column per text character (Sellers)
+static int DistanceDP(std::string_view pattern, std::string_view text, int maxDistance, std::vector<int>& column) {
+    column.resize(pattern.size() + 1);
+    for (std::size_t i = 0; i <= pattern.size(); i++) {
+        column[i] = static_cast<int>(i);
+    }
+    int best = column[pattern.size()];
+    for (char c : text) {
+        // The match can start anywhere, so the first row stays 0
+        int diagonal = 0;
+        for (std::size_t i = 1; i <= pattern.size(); i++) {
+            int above = column[i];
+            column[i] = std::min({above + 1, column[i - 1] + 1, diagonal + (pattern[i - 1] == c ? 0 : 1)});
+            diagonal = above;
+        }
+        best = std::min(best, column[pattern.size()]);
+    }
+    return std::min(best, maxDistance + 1);
+}
+
+static std::string RandomWord(std::mt19937& rng, std::size_t length) {
+    // Few letters so patterns with typos still match now and then
+    std::uniform_int_distribution<int> letter('a', 'l');
+    std::string word;
+    for (std::size_t i = 0; i < length; i++) {
+        word.push_back(static_cast<char>(letter(rng)));
+    }
+    return word;
+}
+
+int main() {
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<std::size_t> textLength(MIN_TEXT_LENGTH, MAX_TEXT_LENGTH);
+    std::vector<std::string> texts;
+    texts.reserve(TEXT_COUNT);
+    for (std::size_t i = 0; i < TEXT_COUNT; i++) {
+        texts.push_back(RandomWord(rng, textLength(rng)));
+    }
+
+    int failed = 0;
+    std::vector<int> column;
+    std::printf("%zu texts of %zu to %zu characters\n", texts.size(), MIN_TEXT_LENGTH, MAX_TEXT_LENGTH);
+    for (std::size_t patternLength : {4, 6, 10, 16, 32}) {
+        std::string pattern = RandomWord(rng, patternLength);
+        int maxDistance = FuzzyMaxDistance(pattern.size());
+        FuzzyPattern fuzzy;
+        fuzzy.Set(pattern);
+
+        std::vector<int> myers(texts.size());
+        std::vector<int> dp(texts.size());
+        auto before = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < texts.size(); i++) {
+            myers[i] = fuzzy.Distance(texts[i], maxDistance);
+        }
+        std::chrono::duration<double, std::milli> myersMs = std::chrono::steady_clock::now() - before;
+
+        before = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < texts.size(); i++) {
+            dp[i] = DistanceDP(pattern, texts[i], maxDistance, column);
+        }
+        std::chrono::duration<double, std::milli> dpMs = std::chrono::steady_clock::now() - before;
+
+        std::size_t matches = std::count_if(myers.begin(), myers.end(), [maxDistance](int distance) {
+            return distance <= maxDistance;
+        });
+        if (myers != dp) {
+            std::printf("FAIL pattern of %zu: Myers and DP distances differ\n", patternLength);
+            failed++;
+            continue;
+        }
+        std::printf(
+            "pattern %2zu, max distance %d: %6zu matches  Myers %7.2f ms  DP %8.2f ms  (%.1fx)\n",
+            patternLength,
+            maxDistance,
+            matches,
+            myersMs.count(),
+            dpMs.count(),
+            dpMs.count() / myersMs.count()
+        );
+    }
+    return failed == 0 ? 0 : 1;
+}
+
+#endif
@@ -0,0 +1,190 @@
+// Host checks of the cover store recovering from interrupted writes, not part of the mod build.
+// g++ -std=c++20 -DBSS_HOST_TEST -Iinclude test/src/PackedStoreRecovery.cpp src/Util/PackedStore.cpp -lz -o packed_store_recovery && ./packed_store_recovery
+#ifdef BSS_HOST_TEST
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "Util/PackedStore.hpp"
+
+using namespace BetterSongSearch::Util;
+
+static int failed = 0;
+
+static void Check(bool condition, std::string const& what) {
+    if (!condition) {
+        std::printf("FAIL %s\n", what.c_str());
+        failed++;
+    }
+}
+
+static std::string Key(int i) {
+    char key[41];
+    std::snprintf(key, sizeof(key), "%040d", i);
+    return key;
+}
+
+static std::vector<uint8_t> Value(int i) {
+    std::vector<uint8_t> value(100 + i * 37 % 500);
+    for (std::size_t j = 0; j < value.size(); j++) {
+        value[j] = static_cast<uint8_t>(i * 31 + j);
+    }
+    return value;
+}
+
+static uint64_t FileSize(std::string const& path) {
+    struct stat st {};
+    return stat(path.c_str(), &st) == 0 ? static_cast<uint64_t>(st.st_size) : 0;
+}
+
+static void CheckKeys(PackedStore& store, int count, std::string const& what) {
+    for (int i = 0; i < count; i++) {
+        auto value = store.Read(Key(i));
+        Check(value.has_value() && *value == Value(i), what + ": key " + std::to_string(i) + " reads back");
+    }
+}
+
+// Writes count values and returns the pack size before the last one
+static uint64_t WriteStore(std::string const& path, int count) {
+    std::filesystem::remove(path + ".pack");
+    std::filesystem::remove(path + ".idx");
+    PackedStore store;
+    store.Open(path);
+    for (int i = 0; i < count - 1; i++) {
+        store.Write(Key(i), Value(i), i);
+    }
+    uint64_t lastRecord = store.FileBytes();
+    store.Write(Key(count - 1), Value(count - 1), count - 1);
+    return lastRecord;
+}
+
+// A crash while appending leaves the pack cut anywhere in the last record, the index already points at it or not
+static void CheckCutRecord(std::string const& path) {
+    static constexpr int COUNT = 20;
+    uint64_t lastRecord = WriteStore(path, COUNT);
+    uint64_t fullSize = FileSize(path + ".pack");
+
+    for (uint64_t cut = lastRecord; cut < fullSize; cut++) {
+        WriteStore(path, COUNT);
+        truncate((path + ".pack").c_str(), static_cast<off_t>(cut));
+
+        PackedStore store;
+        std::string what = "cut at " + std::to_string(cut - lastRecord) + " of " + std::to_string(fullSize - lastRecord);
+        Check(store.Open(path), what + ": opens");
+        Check(store.RecoveredBytes() == cut - lastRecord, what + ": recovered bytes");
+        Check(store.FileBytes() == lastRecord, what + ": pack ends before the last record");
+        Check(store.size() == COUNT - 1, what + ": live count");
+        Check(!store.Read(Key(COUNT - 1)).has_value(), what + ": last key is gone");
+        CheckKeys(store, COUNT - 1, what);
+
+        // The next write goes where the damaged record was
+        store.Write(Key(COUNT - 1), Value(COUNT - 1), COUNT - 1);
+        store.Close();
+        Check(store.Open(path) && store.RecoveredBytes() == 0, what + ": reopens clean after a new write");
+        CheckKeys(store, COUNT, what + " rewritten");
+    }
+}
+
+static void CheckIndexRebuild(std::string const& path) {
+    static constexpr int COUNT = 50;
+
+    WriteStore(path, COUNT);
+    {
+        PackedStore store;
+        store.Open(path);
+        store.Erase(Key(3));
+    }
+    std::filesystem::remove(path + ".idx");
+    {
+        PackedStore store;
+        Check(store.Open(path), "deleted index: opens");
+        Check(store.size() == COUNT - 1, "deleted index: erased key stays erased");
+        Check(!store.Contains(Key(3)), "deleted index: tombstone applied");
+        for (int i = 0; i < COUNT; i++) {
+            if (i != 3) {
+                auto value = store.Read(Key(i));
+                Check(value.has_value() && *value == Value(i), "deleted index: key " + std::to_string(i) + " reads back");
+            }
+        }
+    }
+
+    // Garbage over the header and the first slots
+    WriteStore(path, COUNT);
+    if (FILE* index = std::fopen((path + ".idx").c_str(), "r+b")) {
+        std::vector<uint8_t> garbage(256, 0xA5);
+        std::fwrite(garbage.data(), 1, garbage.size(), index);
+        std::fclose(index);
+    }
+    {
+        PackedStore store;
+        Check(store.Open(path), "corrupted index: opens");
+        Check(store.size() == COUNT, "corrupted index: live count");
+        CheckKeys(store, COUNT, "corrupted index");
+    }
+
+    // Cut to half its size
+    WriteStore(path, COUNT);
+    truncate((path + ".idx").c_str(), static_cast<off_t>(FileSize(path + ".idx") / 2));
+    {
+        PackedStore store;
+        Check(store.Open(path), "truncated index: opens");
+        CheckKeys(store, COUNT, "truncated index");
+    }
+}
+
+// Compact renames the new pack first and the new index second, a crash in between leaves the old index next to the new pack
+static void CheckInterruptedCompact(std::string const& path) {
+    static constexpr int COUNT = 40;
+
+    WriteStore(path, COUNT);
+    std::filesystem::path oldIndex = path + ".idx.old";
+    {
+        PackedStore store;
+        store.Open(path);
+        for (int i = COUNT; i < COUNT + 10; i++) {
+            store.Write(Key(i), Value(i), i);
+            store.Erase(Key(i));
+        }
+        std::filesystem::copy_file(path + ".idx", oldIndex, std::filesystem::copy_options::overwrite_existing);
+        Check(store.Compact(), "compact: succeeds");
+    }
+    std::filesystem::copy_file(oldIndex, path + ".idx", std::filesystem::copy_options::overwrite_existing);
+    // The new index was still being built
+    std::filesystem::copy_file(oldIndex, path + ".idx.tmp", std::filesystem::copy_options::overwrite_existing);
+    truncate((path + ".idx.tmp").c_str(), 64);
+
+    PackedStore store;
+    Check(store.Open(path), "interrupted compact: opens");
+    Check(store.RecoveredBytes() == 0, "interrupted compact: pack is complete");
+    Check(store.size() == COUNT, "interrupted compact: live count");
+    for (int i = COUNT; i < COUNT + 10; i++) {
+        Check(!store.Contains(Key(i)), "interrupted compact: erased key " + std::to_string(i) + " stays erased");
+    }
+    CheckKeys(store, COUNT, "interrupted compact");
+    std::filesystem::remove(oldIndex);
+}
+
+int main() {
+    char directory[] = "/tmp/packed_store_XXXXXX";
+    if (mkdtemp(directory) == nullptr) {
+        std::printf("Can't create a temp directory\n");
+        return 1;
+    }
+    std::string path = std::string(directory) + "/covers";
+
+    CheckCutRecord(path);
+    CheckIndexRebuild(path);
+    CheckInterruptedCompact(path);
+
+    std::filesystem::remove_all(directory);
+    std::printf("%d checks failed\n", failed);
+    return failed == 0 ? 0 : 1;
+}
+
+#endif
@@ -0,0 +1,203 @@
+// Host benchmark of the difficulty bound checks on float fields against the quantized columns, not part of the mod build.
+// g++ -std=c++20 -O2 -DBSS_HOST_TEST -Iinclude test/src/QuantizedFilterBenchmark.cpp src/Util/QuantizedColumns.cpp -o quantized_bench && ./quantized_bench
+#ifdef BSS_HOST_TEST
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "Util/QuantizedColumns.hpp"
+
+using namespace BetterSongSearch::Util;
+
+// About the number of difficulties in the BeatSaver dataset
+static constexpr std::size_t DIFF_COUNT = 480000;
+static constexpr int ROUNDS = 20;
+
+// About the layout of SongDifficulty, the float pass reads it for every difficulty
+struct BenchDifficulty {
+    uint32_t songIndex;
+    uint8_t characteristic;
+    uint8_t difficulty;
+    uint8_t mods;
+    float starsSS;
+    float starsBL;
+    float njs;
+    uint32_t bombs;
+    uint32_t notes;
+    uint32_t obstacles;
+    float songDuration;
+};
+
+struct BenchFilter {
+    char const* name;
+    float minStars;
+    float maxStars;
+    float minNJS;
+    float maxNJS;
+    float minNPS;
+    float maxNPS;
+};
+
+// Made once per filter pass, like the preprocessed bounds of FilterProfile
+struct BenchBounds {
+    QuantizedColumns::Bounds stars;
+    QuantizedColumns::Bounds njs;
+    QuantizedColumns::Bounds nps;
+};
+
+static float Nps(BenchDifficulty const& diff) {
+    return diff.songDuration > 0 ? static_cast<float>(diff.notes) / diff.songDuration : -1.0f;
+}
+
+static bool HasStarFilter(BenchFilter const& filter) {
+    return filter.minStars > 0 || filter.maxStars != std::numeric_limits<float>::max();
+}
+
+// Same checks as DifficultyCheck on the exact values, with ScoreSaber as the leaderboard
+static bool PassesFloat(BenchDifficulty const& diff, BenchFilter const& filter) {
+    if (HasStarFilter(filter) && (diff.starsSS < filter.minStars || diff.starsSS > filter.maxStars)) {
+        return false;
+    }
+    if (diff.njs < filter.minNJS || diff.njs > filter.maxNJS) {
+        return false;
+    }
+    float nps = Nps(diff);
+    if (nps >= 0 && (nps < filter.minNPS || nps > filter.maxNPS)) {
+        return false;
+    }
+    return true;
+}
+
+// Same order as DifficultyCheck, the difficulty is only read for values close to a bound
+static bool PassesQuantized(
+    QuantizedColumns::Entry const& entry, BenchDifficulty const& diff, BenchFilter const& filter, BenchBounds const& bounds, std::size_t& edges
+) {
+    auto stars = HasStarFilter(filter) ? QuantizedColumns::Check(entry.starsSS, bounds.stars) : BoundCheck::Passes;
+    if (stars == BoundCheck::Fails) {
+        return false;
+    }
+    if (stars == BoundCheck::Edge) {
+        edges++;
+        if (diff.starsSS < filter.minStars || diff.starsSS > filter.maxStars) {
+            return false;
+        }
+    }
+    auto njs = QuantizedColumns::Check(entry.njs, bounds.njs);
+    if (njs == BoundCheck::Fails) {
+        return false;
+    }
+    auto nps = entry.nps == QuantizedColumns::NO_VALUE ? BoundCheck::Passes : QuantizedColumns::Check(entry.nps, bounds.nps);
+    if (nps == BoundCheck::Fails) {
+        return false;
+    }
+    if (njs == BoundCheck::Edge) {
+        edges++;
+        if (diff.njs < filter.minNJS || diff.njs > filter.maxNJS) {
+            return false;
+        }
+    }
+    if (nps == BoundCheck::Edge) {
+        edges++;
+        float exact = Nps(diff);
+        if (exact < filter.minNPS || exact > filter.maxNPS) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main() {
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> chance(0, 1);
+    std::uniform_real_distribution<float> njs(8, 24);
+    std::uniform_int_distribution<uint32_t> notes(50, 3000);
+    std::uniform_real_distribution<float> duration(60, 400);
+    std::uniform_real_distribution<float> stars(1, 14);
+
+    std::vector<BenchDifficulty> diffs(DIFF_COUNT);
+    QuantizedColumns columns;
+    columns.Reserve(DIFF_COUNT);
+    for (std::size_t i = 0; i < DIFF_COUNT; i++) {
+        auto& diff = diffs[i];
+        diff = {};
+        diff.songIndex = static_cast<uint32_t>(i / 4);
+        // Few difficulties are ranked, a few songs have no duration
+        diff.starsSS = chance(rng) < 0.08f ? stars(rng) : 0;
+        diff.starsBL = chance(rng) < 0.1f ? stars(rng) : 0;
+        diff.njs = njs(rng);
+        diff.notes = notes(rng);
+        diff.songDuration = chance(rng) < 0.01f ? 0 : duration(rng);
+        columns.Push(diff.njs, Nps(diff), diff.starsSS, diff.starsBL);
+    }
+
+    float none = std::numeric_limits<float>::max();
+    BenchFilter filters[] = {
+        {"NJS 14 to 18", 0, none, 14, 18, 0, none},
+        {"NPS 3 to 6", 0, none, 0, none, 3, 6},
+        {"NJS and NPS", 0, none, 12, 20, 2, 8},
+        {"stars 5 to 9", 5, 9, 0, none, 0, none},
+        {"stars, NJS and NPS", 4, 10, 12, 20, 2, 8},
+    };
+
+    int failed = 0;
+    std::printf(
+        "%zu difficulties, average of %d rounds, difficulties %zu KB, quantized columns %zu KB\n",
+        diffs.size(),
+        ROUNDS,
+        diffs.size() * sizeof(BenchDifficulty) / 1024,
+        columns.bytes() / 1024
+    );
+    for (auto const& filter : filters) {
+        std::vector<uint8_t> exact(DIFF_COUNT);
+        std::vector<uint8_t> quantized(DIFF_COUNT);
+        std::size_t edges = 0;
+        BenchBounds bounds{
+            QuantizedColumns::MakeBounds(QuantizedColumns::STARS_SCALE, filter.minStars, filter.maxStars),
+            QuantizedColumns::MakeBounds(QuantizedColumns::NJS_SCALE, filter.minNJS, filter.maxNJS),
+            QuantizedColumns::MakeBounds(QuantizedColumns::NPS_SCALE, filter.minNPS, filter.maxNPS),
+        };
+
+        auto before = std::chrono::steady_clock::now();
+        for (int round = 0; round < ROUNDS; round++) {
+            for (std::size_t i = 0; i < DIFF_COUNT; i++) {
+                exact[i] = PassesFloat(diffs[i], filter);
+            }
+        }
+        std::chrono::duration<double, std::micro> floatMicros = std::chrono::steady_clock::now() - before;
+
+        before = std::chrono::steady_clock::now();
+        for (int round = 0; round < ROUNDS; round++) {
+            edges = 0;
+            for (std::size_t i = 0; i < DIFF_COUNT; i++) {
+                quantized[i] = PassesQuantized(columns.at(i), diffs[i], filter, bounds, edges);
+            }
+        }
+        std::chrono::duration<double, std::micro> quantizedMicros = std::chrono::steady_clock::now() - before;
+
+        if (exact != quantized) {
+            std::printf("FAIL %s: quantized checks disagree with the exact ones\n", filter.name);
+            failed++;
+            continue;
+        }
+        std::size_t passing = 0;
+        for (auto passes : exact) {
+            passing += passes;
+        }
+        std::printf(
+            "%-20s %6zu pass  float %8.1f us  quantized %8.1f us  (%.1fx)  %5zu exact reads\n",
+            filter.name,
+            passing,
+            floatMicros.count() / ROUNDS,
+            quantizedMicros.count() / ROUNDS,
+            floatMicros.count() / quantizedMicros.count(),
+            edges
+        );
+    }
+    return failed == 0 ? 0 : 1;
+}
+
+#endif
@@ -0,0 +1,53 @@
+// Host checks for the search text normalizer, not part of the mod build.
+// g++ -std=c++20 -DBSS_HOST_TEST -Iinclude test/src/TextNormalizeCases.cpp src/Util/TextNormalize.cpp -o normalize_cases && ./normalize_cases
+#ifdef BSS_HOST_TEST
+
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+#include "Util/TextNormalize.hpp"
+
+using namespace BetterSongSearch::Util;
+
+struct NormalizeCase {
+    std::string_view input;
+    std::string_view normalized;
+    std::string_view romaji;
+};
+
+static constexpr NormalizeCase cases[] = {
+    {"Hello, World!", "hello world", "hello world"},
+    {"Café Été", "cafe ete", "cafe ete"},
+    {"ｆｕｌｌ", "full", "full"},
+    {"ジャンプ", "じゃんぷ", "janpu"},
+    {"きゃ", "きゃ", "kya"},
+    {"しゃしん", "しゃしん", "shashin"},
+    {"ちょっと", "ちょっと", "chotto"},
+    {"ファイト", "ふぁいと", "faito"},
+    // Small kana with nothing to combine with
+    {"ゃ", "ゃ", "ya"},
+    {"いゃ", "いゃ", "iya"},
+    {"かいゃ", "かいゃ", "kaiya"},
+    {"みいゃ", "みいゃ", "miiya"},
+    {"いぇ", "いぇ", "ie"},
+    {"ふぁいと", "ふぁいと", "faito"},
+    {"まっちゃ", "まっちゃ", "matcha"},
+};
+
+int main() {
+    int failed = 0;
+    for (auto const& test : cases) {
+        std::string normalized = NormalizeSearchText(test.input);
+        std::string romaji;
+        KanaToRomaji(normalized, romaji);
+        if (normalized != test.normalized || romaji != test.romaji) {
+            std::printf("FAIL %.*s: got [%s] [%s]\n", static_cast<int>(test.input.size()), test.input.data(), normalized.c_str(), romaji.c_str());
+            failed++;
+        }
+    }
+    std::printf("%d of %zu cases failed\n", failed, std::size(cases));
+    return failed == 0 ? 0 : 1;
+}
+
+#endif